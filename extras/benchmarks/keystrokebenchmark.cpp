@@ -0,0 +1,305 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Measures the path every keystroke takes during a training: the key event
+// reaching TrainingLineCore, which logs the character with TrainingStats and
+// appends it to the actual line. TrainingStats::logCharacter() is measured on
+// its own as well, to tell its share from the one of the line.
+//
+// The keystrokes must not allocate any memory. malloc() and operator new are
+// replaced with versions counting the allocations of the measuring thread,
+// the benchmark fails if any happen while keystrokes are fed. Preparing a
+// line is allowed to allocate, it happens once per line.
+
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QStringList>
+#include <QVector>
+
+#include "core/trainingstats.h"
+#include "declarativeitems/traininglinecore.h"
+#include "preferences.h"
+
+static thread_local bool countAllocations = false;
+static thread_local qint64 allocationCount = 0;
+
+#if defined(__GLIBC__)
+
+// Qt allocates the data of its containers with malloc() directly, glibc
+// lets the program replace it and call the real implementation
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+    if (countAllocations)
+        allocationCount++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    if (countAllocations)
+        allocationCount++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size)
+{
+    if (countAllocations)
+        allocationCount++;
+    return __libc_realloc(pointer, size);
+}
+
+#endif
+
+void* operator new(size_t size)
+{
+    if (countAllocations)
+        allocationCount++;
+
+    void* pointer = std::malloc(size? size: 1);
+
+    if (!pointer)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    if (countAllocations)
+        allocationCount++;
+    return std::malloc(size? size: 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+// operator new counts once more as it forwards to malloc(), the count only
+// has to tell none from some
+static qint64 countedAllocations(qint64 start)
+{
+    countAllocations = false;
+    return allocationCount - start;
+}
+
+static qint64 startCountingAllocations()
+{
+    countAllocations = true;
+    return allocationCount;
+}
+
+static const char* const sampleText =
+    "The quick brown fox jumps over the lazy dog. Pack my box with five dozen\n"
+    "liquor jugs. How vexingly quick daft zebras jump! Sphinx of black quartz,\n"
+    "judge my vow. The five boxing wizards jump quickly. Jackdaws love my big\n"
+    "sphinx of quartz. Waltz, bad nymph, for quick jigs vex. Glib jocks quiz\n"
+    "nymph to vex dwarf. Bright vixens jump; dozy fowl quack. 1234567890 -=+";
+
+static void sendKey(QQuickItem* target, int key, const QString& text = QString())
+{
+    QKeyEvent event(QEvent::KeyPress, key, Qt::NoModifier, text);
+    QCoreApplication::sendEvent(target, &event);
+}
+
+static bool report(const char* name, qint64 nsecs, qint64 keystrokes, qint64 allocations)
+{
+    printf("%-22s %10lld keystrokes   %8.1f ns per keystroke   %8lld allocations\n",
+           name, keystrokes, double(nsecs) / keystrokes, allocations);
+
+    return allocations == 0;
+}
+
+int main(int argc, char** argv)
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the keystroke path of TrainingLineCore and TrainingStats and checks it doesn't allocate");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("iterations", "passes over the sample text", "count", "2000"));
+    parser.addOption(QCommandLineOption("error-interval", "type a wrong character and correct it every n characters, 0 for none", "n", "20"));
+    parser.process(app);
+
+    const int iterations = qMax(1, parser.value("iterations").toInt());
+    const int errorInterval = qMax(0, parser.value("error-interval").toInt());
+    const QStringList lines = QString::fromUtf8(sampleText).split('\n');
+
+    // the texts of the key events are made up front, creating them would
+    // count as allocations of the keystrokes
+    QVector<QVector<QString> > lineKeyTexts;
+
+    foreach (const QString& line, lines)
+    {
+        QVector<QString> keyTexts;
+
+        for (int j = 0; j < line.length(); j++)
+        {
+            keyTexts.append(QString(line.at(j)));
+        }
+
+        lineKeyTexts.append(keyTexts);
+    }
+
+    const QString wrongKeyText = QString(QChar('#'));
+
+    // the defaults of a fresh profile, set explicitly so the results don't
+    // depend on the configuration of the user running the benchmark
+    Preferences::setEnforceTypingErrorCorrection(true);
+    Preferences::setNextLineWithReturn(true);
+    Preferences::setNextLineWithSpace(false);
+
+    QElapsedTimer timer;
+    bool passed = true;
+
+    for (int recordKeystrokes = 0; recordKeystrokes <= 1; recordKeystrokes++)
+    {
+        Preferences::setRecordKeystrokes(recordKeystrokes);
+
+        TrainingStats stats;
+        TrainingLineCore core;
+        core.setTrainingStats(&stats);
+        core.setActive(true);
+        stats.startTraining();
+
+        qint64 keystrokes = 0;
+        qint64 allocations = 0;
+        qint64 nsecs = 0;
+
+        for (int i = 0; i < iterations; i++)
+        {
+            for (int k = 0; k < lines.count(); k++)
+            {
+                const QString& line = lines.at(k);
+                const QVector<QString>& keyTexts = lineKeyTexts.at(k);
+
+                core.setReferenceLine(line);
+
+                timer.start();
+                const qint64 allocationStart = startCountingAllocations();
+
+                for (int j = 0; j < line.length(); j++)
+                {
+                    if (errorInterval > 0 && j % errorInterval == errorInterval - 1)
+                    {
+                        sendKey(&core, Qt::Key_unknown, wrongKeyText);
+                        sendKey(&core, Qt::Key_Backspace);
+                        keystrokes += 2;
+                    }
+
+                    sendKey(&core, Qt::Key_unknown, keyTexts.at(j));
+                    keystrokes++;
+
+                    // like LessonPainter, which reads the actual line on every
+                    // change and lets go of it again
+                    const QString actualLine = core.actualLine();
+                    Q_UNUSED(actualLine)
+                }
+
+                sendKey(&core, Qt::Key_Return);
+                keystrokes++;
+
+                allocations += countedAllocations(allocationStart);
+                nsecs += timer.nsecsElapsed();
+            }
+        }
+
+        stats.stopTraining();
+
+        passed = report(recordKeystrokes? "line, with journal": "line", nsecs, keystrokes, allocations) && passed;
+    }
+
+    TrainingStats stats;
+    stats.startTraining();
+
+    qint64 characters = 0;
+    qint64 allocations = 0;
+    qint64 nsecs = 0;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        // makes room for the timestamps of the pass, like TrainingLineCore
+        // does for every line
+        foreach (const QString& line, lines)
+        {
+            stats.reserve(line);
+        }
+
+        timer.start();
+        const qint64 allocationStart = startCountingAllocations();
+
+        foreach (const QString& line, lines)
+        {
+            for (int j = 0; j < line.length(); j++)
+            {
+                const bool correct = errorInterval == 0 || j % errorInterval != errorInterval - 1;
+                stats.logCharacter(line.at(j), correct? TrainingStats::CorrectCharacter: TrainingStats::IncorrectCharacter);
+                characters++;
+            }
+        }
+
+        allocations += countedAllocations(allocationStart);
+        nsecs += timer.nsecsElapsed();
+    }
+
+    passed = report("logCharacter", nsecs, characters, allocations) && passed;
+
+    if (!passed)
+    {
+        fprintf(stderr, "keystrokes allocated memory\n");
+        return 1;
+    }
+
+    return 0;
+}
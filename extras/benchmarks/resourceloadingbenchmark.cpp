@@ -0,0 +1,297 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Compares ResourceDataAccess, which reads courses and keyboard layouts in a
+// single pass with QXmlStreamReader, with the former loader, which validated
+// every file against its schema and then parsed it again into a DOM tree.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QDomDocument>
+#include <QDomElement>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
+#include <QXmlSchema>
+#include <QXmlSchemaValidator>
+
+#include <cstdio>
+
+#include "core/course.h"
+#include "core/lesson.h"
+#include "core/keyboardlayout.h"
+#include "core/key.h"
+#include "core/keychar.h"
+#include "core/specialkey.h"
+#include "core/resourcedataaccess.h"
+#include "core/resourcevalidator.h"
+
+static QDomDocument loadDomDocument(const QString& path, const QString& schemaPath)
+{
+    QDomDocument doc;
+
+    QFile schemaFile(schemaPath);
+    if (!schemaFile.open(QIODevice::ReadOnly))
+        return doc;
+    QXmlSchema schema;
+    schema.load(&schemaFile, QUrl::fromLocalFile(schemaPath));
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return doc;
+    QXmlSchemaValidator validator(schema);
+    if (!validator.validate(&file))
+        return doc;
+    file.reset();
+    doc.setContent(&file);
+    return doc;
+}
+
+static bool loadCourseDom(const QString& path, const QString& schemaPath, Course* target)
+{
+    QDomDocument doc = loadDomDocument(path, schemaPath);
+    if (doc.isNull())
+        return false;
+    QDomElement root(doc.documentElement());
+
+    target->setId(root.firstChildElement("id").text());
+    target->setTitle(root.firstChildElement("title").text());
+    target->setDescription(root.firstChildElement("description").text());
+    target->setKeyboardLayoutName(root.firstChildElement("keyboardLayout").text());
+    target->clearLessons();
+
+    for (QDomElement lessonNode = root.firstChildElement("lessons").firstChildElement();
+         !lessonNode.isNull();
+         lessonNode = lessonNode.nextSiblingElement())
+    {
+        Lesson* lesson = new Lesson();
+        lesson->setId(lessonNode.firstChildElement("id").text());
+        lesson->setTitle(lessonNode.firstChildElement("title").text());
+        lesson->setNewCharacters(lessonNode.firstChildElement("newCharacters").text());
+        lesson->setText(lessonNode.firstChildElement("text").text());
+        target->addLesson(lesson);
+    }
+
+    return true;
+}
+
+static bool loadKeyboardLayoutDom(const QString& path, const QString& schemaPath, KeyboardLayout* target)
+{
+    QDomDocument doc = loadDomDocument(path, schemaPath);
+    if (doc.isNull())
+        return false;
+    QDomElement root(doc.documentElement());
+
+    target->clearKeys();
+    target->setId(root.firstChildElement("id").text());
+    target->setTitle(root.firstChildElement("title").text());
+    target->setName(root.firstChildElement("name").text());
+    target->setWidth(root.firstChildElement("width").text().toInt());
+    target->setHeight(root.firstChildElement("height").text().toInt());
+
+    for (QDomElement keyNode = root.firstChildElement("keys").firstChildElement();
+         !keyNode.isNull();
+         keyNode = keyNode.nextSiblingElement())
+    {
+        AbstractKey* abstractKey;
+
+        if (keyNode.tagName() == "key")
+        {
+            Key* key = new Key();
+            key->setFingerIndex(keyNode.attribute("fingerIndex").toInt());
+            key->setHasHapticMarker(keyNode.attribute("hasHapticMarker") == "true");
+            for (QDomElement charNode = keyNode.firstChildElement("char");
+                 !charNode.isNull();
+                 charNode = charNode.nextSiblingElement("char"))
+            {
+                KeyChar* keyChar = new KeyChar(key);
+                keyChar->setValue(charNode.text().at(0));
+                keyChar->setPositionStr(charNode.attribute("position"));
+                keyChar->setModifier(charNode.attribute("modifier"));
+                key->addKeyChar(keyChar);
+            }
+            abstractKey = key;
+        }
+        else
+        {
+            SpecialKey* specialKey = new SpecialKey();
+            specialKey->setTypeStr(keyNode.attribute("type"));
+            specialKey->setModifierId(keyNode.attribute("modifierId"));
+            specialKey->setLabel(keyNode.attribute("label"));
+            abstractKey = specialKey;
+        }
+        abstractKey->setLeft(keyNode.attribute("left").toInt());
+        abstractKey->setTop(keyNode.attribute("top").toInt());
+        abstractKey->setWidth(keyNode.attribute("width").toInt());
+        abstractKey->setHeight(keyNode.attribute("height").toInt());
+        target->addKey(abstractKey);
+    }
+
+    return true;
+}
+
+static bool sameCourse(Course* a, Course* b)
+{
+    if (a->id() != b->id() || a->title() != b->title() || a->description() != b->description() ||
+        a->keyboardLayoutName() != b->keyboardLayoutName() || a->lessonCount() != b->lessonCount())
+        return false;
+
+    for (int i = 0; i < a->lessonCount(); i++)
+    {
+        Lesson* const lessonA = a->lesson(i);
+        Lesson* const lessonB = b->lesson(i);
+
+        if (lessonA->id() != lessonB->id() || lessonA->title() != lessonB->title() ||
+            lessonA->newCharacters() != lessonB->newCharacters() || lessonA->text() != lessonB->text())
+            return false;
+    }
+
+    return true;
+}
+
+static bool sameKeyboardLayout(KeyboardLayout* a, KeyboardLayout* b)
+{
+    if (a->id() != b->id() || a->title() != b->title() || a->name() != b->name() ||
+        a->width() != b->width() || a->height() != b->height() || a->keyCount() != b->keyCount())
+        return false;
+
+    for (int i = 0; i < a->keyCount(); i++)
+    {
+        AbstractKey* const keyA = a->key(i);
+        AbstractKey* const keyB = b->key(i);
+
+        if (keyA->rect() != keyB->rect() || keyA->metaObject() != keyB->metaObject())
+            return false;
+
+        Key* const charKeyA = qobject_cast<Key*>(keyA);
+        Key* const charKeyB = qobject_cast<Key*>(keyB);
+
+        if (charKeyA && charKeyA->keyCharCount() != charKeyB->keyCharCount())
+            return false;
+    }
+
+    return true;
+}
+
+struct Result
+{
+    int files;
+    qint64 bytes;
+    qint64 streamNSecs;
+    qint64 domNSecs;
+};
+
+static void report(const char* name, const Result& result, int iterations)
+{
+    printf("%-18s %4d files %8lld KiB   stream %8.3f ms   dom %8.3f ms   per pass\n",
+           name, result.files, result.bytes / 1024,
+           result.streamNSecs / 1e6 / iterations, result.domNSecs / 1e6 / iterations);
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares the streaming resource loader with the former DOM loader");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("data", "directory with the courses and keyboardlayouts directories", "path", KTOUCH_SOURCE_DIR "/data"));
+    parser.addOption(QCommandLineOption("schemata", "directory with the schema files", "path", KTOUCH_SOURCE_DIR "/src/schemata"));
+    parser.addOption(QCommandLineOption("iterations", "passes over all files", "count", "20"));
+    parser.process(app);
+
+    const QDir dataDir(parser.value("data"));
+    const QDir schemataDir(parser.value("schemata"));
+    const int iterations = qMax(1, parser.value("iterations").toInt());
+    const QStringList filter = QStringList() << "*.xml";
+
+    // the first pass validates the files, records them as trusted and writes
+    // their binary caches, like the first start of KTouch does for the files
+    // it ships; later passes measure loading from the caches
+    ResourceValidator::setSchemataDir(schemataDir.path());
+    ResourceValidator::setBuiltInDirs(QStringList() << dataDir.path());
+
+    ResourceDataAccess access;
+    QElapsedTimer timer;
+
+    const QDir coursesDir(dataDir.filePath("courses"));
+    const QString courseSchema = schemataDir.filePath("course.xsd");
+    Result courses = {0, 0, 0, 0};
+
+    foreach (const QString& name, coursesDir.entryList(filter, QDir::Files, QDir::Name))
+    {
+        const QString path = coursesDir.filePath(name);
+        Course streamCourse;
+        Course domCourse;
+
+        timer.start();
+        for (int i = 0; i < iterations; i++)
+            access.loadCourse(path, &streamCourse);
+        courses.streamNSecs += timer.nsecsElapsed();
+
+        timer.start();
+        for (int i = 0; i < iterations; i++)
+            loadCourseDom(path, courseSchema, &domCourse);
+        courses.domNSecs += timer.nsecsElapsed();
+
+        if (!sameCourse(&streamCourse, &domCourse))
+        {
+            qWarning() << "the loaders disagree on" << path;
+        }
+
+        courses.files++;
+        courses.bytes += QFileInfo(path).size();
+    }
+
+    const QDir keyboardLayoutsDir(dataDir.filePath("keyboardlayouts"));
+    const QString keyboardLayoutSchema = schemataDir.filePath("keyboardlayout.xsd");
+    Result keyboardLayouts = {0, 0, 0, 0};
+
+    foreach (const QString& name, keyboardLayoutsDir.entryList(filter, QDir::Files, QDir::Name))
+    {
+        const QString path = keyboardLayoutsDir.filePath(name);
+        KeyboardLayout streamKeyboardLayout;
+        KeyboardLayout domKeyboardLayout;
+
+        timer.start();
+        for (int i = 0; i < iterations; i++)
+            access.loadKeyboardLayout(path, &streamKeyboardLayout);
+        keyboardLayouts.streamNSecs += timer.nsecsElapsed();
+
+        timer.start();
+        for (int i = 0; i < iterations; i++)
+            loadKeyboardLayoutDom(path, keyboardLayoutSchema, &domKeyboardLayout);
+        keyboardLayouts.domNSecs += timer.nsecsElapsed();
+
+        if (!sameKeyboardLayout(&streamKeyboardLayout, &domKeyboardLayout))
+        {
+            qWarning() << "the loaders disagree on" << path;
+        }
+
+        keyboardLayouts.files++;
+        keyboardLayouts.bytes += QFileInfo(path).size();
+    }
+
+    report("courses", courses, iterations);
+    report("keyboard layouts", keyboardLayouts, iterations);
+
+    return 0;
+}
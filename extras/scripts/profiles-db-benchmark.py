@@ -0,0 +1,460 @@
+#
+#  Copyright 2026  agent <agent@local>
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License as
+#  published by the Free Software Foundation; either version 2 of
+#  the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+# Benchmarks for the profile database (profiles.db) of KTouch.
+#
+# The schema below mirrors src/core/dbaccess.cpp and has to be kept in sync
+# with it. TABLES and INDEXES describe schema 1.2, the subcommands apply the
+# later changes they depend on themselves.
+
+from __future__ import print_function
+
+import argparse
+import glob
+import os
+import random
+import sqlite3
+import tempfile
+import time
+import uuid
+import xml.etree.ElementTree as etree
+
+TABLES = [
+    "CREATE TABLE IF NOT EXISTS metadata (key TEXT PRIMARY KEY, value TEXT)",
+    "CREATE TABLE IF NOT EXISTS profiles (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT, skill_level INTEGER, last_used_course_id TEXT)",
+    "CREATE TABLE IF NOT EXISTS training_stats (id INTEGER PRIMARY KEY AUTOINCREMENT, profile_id INTEGER, course_id TEXT, lesson_id TEXT, date INT, characters_typed INTEGER, error_count INTEGER, elapsed_time INTEGER)",
+    "CREATE TABLE IF NOT EXISTS training_stats_errors (id INTEGER PRIMARY KEY AUTOINCREMENT, stats_id INTEGER, character TEXT, count INTEGER)",
+    "CREATE TABLE IF NOT EXISTS profile_summary (profile_id INTEGER PRIMARY KEY, lessons_trained INTEGER, total_training_time INTEGER, last_training_session INTEGER)",
+    "CREATE TABLE IF NOT EXISTS course_progress (id INTEGER PRIMARY KEY AUTOINCREMENT, profile_id INTEGER, course_id TEXT, type INTEGER, lesson_id TEXT)",
+    "CREATE TABLE IF NOT EXISTS courses (id TEXT PRIMARY KEY, title TEXT, description TEXT, keyboard_layout_name TEXT)",
+    "CREATE TABLE IF NOT EXISTS course_lessons (id TEXT PRIMARY KEY, course_id TEXT, title TEXT, new_characters TEXT, text TEXT)",
+    "CREATE TABLE IF NOT EXISTS keyboard_layouts (id TEXT PRIMARY KEY, title TEXT, name TEXT, width INTEGER, height INTEGER)",
+    "CREATE TABLE IF NOT EXISTS keyboard_layout_keys (id INTEGER PRIMARY KEY AUTOINCREMENT, keyboard_layout_id TEXT, left INTEGER, top INTEGER, width INTEGER, height INTEGER, type INTEGER, finger_index INTEGER, has_haptic_marker INTEGER, special_key_type TEXT, modifier_id TEXT, label TEXT)",
+    "CREATE TABLE IF NOT EXISTS keyboard_layout_key_chars (id INTEGER PRIMARY KEY AUTOINCREMENT, key_id INTEGER, position INTEGER, character TEXT, modifier TEXT)",
+    "CREATE TABLE IF NOT EXISTS custom_lessons (id TEXT PRIMARY KEY, profile_id INTEGER, title TEXT, text TEXT, keyboard_layout_name TEXT)",
+]
+
+# schema version 1.2
+INDEXES = [
+    "CREATE INDEX IF NOT EXISTS training_stats_lesson_index ON training_stats (profile_id, course_id, lesson_id, date, characters_typed, error_count, elapsed_time)",
+    "CREATE INDEX IF NOT EXISTS training_stats_date_index ON training_stats (profile_id, date)",
+    "CREATE INDEX IF NOT EXISTS training_stats_errors_stats_index ON training_stats_errors (stats_id, character, count)",
+    "CREATE INDEX IF NOT EXISTS course_progress_index ON course_progress (profile_id, course_id, type, lesson_id)",
+    "CREATE INDEX IF NOT EXISTS custom_lessons_profile_index ON custom_lessons (profile_id, keyboard_layout_name)",
+    "CREATE INDEX IF NOT EXISTS course_lessons_course_index ON course_lessons (course_id)",
+    "CREATE INDEX IF NOT EXISTS keyboard_layout_keys_layout_index ON keyboard_layout_keys (keyboard_layout_id)",
+    "CREATE INDEX IF NOT EXISTS keyboard_layout_key_chars_key_index ON keyboard_layout_key_chars (key_id)",
+]
+
+# the hot queries of ProfileDataAccess, with their parameters drawn from the
+# synthetic history
+QUERIES = [
+    ("loadReferenceTrainingStats",
+     "SELECT id, characters_typed, error_count, elapsed_time FROM training_stats WHERE profile_id = ? AND course_id = ? AND lesson_id = ? ORDER BY date DESC LIMIT 1",
+     lambda p: (p["profile"], p["course"], p["lesson"])),
+    ("training stats errors",
+     "SELECT character, count FROM training_stats_errors WHERE stats_id = ?",
+     lambda p: (p["stats"],)),
+    ("findCourseProgressId",
+     "SELECT id FROM course_progress WHERE profile_id = ? AND course_id = ? AND type = ? LIMIT 1",
+     lambda p: (p["profile"], p["course"], 0)),
+    ("lessonsTrained",
+     "SELECT COUNT(*) FROM training_stats WHERE profile_id = ?",
+     lambda p: (p["profile"],)),
+    ("totalTrainingTime",
+     "SELECT SUM(elapsed_time) FROM training_stats WHERE profile_id = ?",
+     lambda p: (p["profile"],)),
+    ("lastTrainingSession",
+     "SELECT date FROM training_stats WHERE profile_id = ? ORDER BY date DESC LIMIT 1",
+     lambda p: (p["profile"],)),
+    ("learningProgressQuery",
+     "SELECT date, characters_typed, error_count, elapsed_time, lesson_id FROM training_stats WHERE profile_id = ? AND course_id = ?",
+     lambda p: (p["profile"], p["course"])),
+]
+
+# the storage modes of DbAccess::applyStorageSettings()
+STORAGE_MODES = [
+    ("safe", ["PRAGMA journal_mode = DELETE", "PRAGMA synchronous = FULL"]),
+    ("balanced", ["PRAGMA journal_mode = WAL", "PRAGMA synchronous = NORMAL"]),
+    ("fast", ["PRAGMA journal_mode = WAL", "PRAGMA synchronous = OFF"]),
+]
+
+PROFILES = 5
+COURSES = 20
+LESSONS_PER_COURSE = 30
+
+
+def encode_varint(value):
+    data = bytearray()
+    while value >= 0x80:
+        data.append((value & 0x7f) | 0x80)
+        value >>= 7
+    data.append(value)
+    return data
+
+
+def encode_errors(errors):
+    """encodes (character, count) pairs like ErrorHistogram::toByteArray()"""
+    data = bytearray([1])
+    for character, count in sorted(errors, key=lambda error: -error[1]):
+        data += encode_varint(ord(character))
+        data += encode_varint(count)
+    return bytes(data)
+
+
+def encode_keystrokes(keystrokes):
+    """encodes (time, expected, typed) tuples like KeystrokeJournal, typed is None for corrections"""
+    data = bytearray([1])
+    last_time = 0
+    for keystroke_time, expected, typed in keystrokes:
+        delta = max(0, keystroke_time - last_time)
+        last_time += delta
+        if typed is None:
+            data += encode_varint(delta << 2 | 2)
+        elif typed == expected:
+            data += encode_varint(delta << 2)
+            data += encode_varint(ord(expected))
+        else:
+            data += encode_varint(delta << 2 | 1)
+            data += encode_varint(ord(expected))
+            data += encode_varint(ord(typed))
+    return bytes(data)
+
+
+def create_history(path, rows):
+    if os.path.exists(path):
+        os.remove(path)
+
+    db = sqlite3.connect(path)
+
+    for sql in TABLES:
+        db.execute(sql)
+
+    db.execute("INSERT INTO metadata (key, value) VALUES ('version', '1.1')")
+
+    courses = [str(uuid.uuid4()) for i in range(COURSES)]
+    lessons = dict((course, [str(uuid.uuid4()) for i in range(LESSONS_PER_COURSE)]) for course in courses)
+    rng = random.Random(42)
+    date = 1300000000000
+
+    for profile in range(1, PROFILES + 1):
+        db.execute("INSERT INTO profiles (name, skill_level) VALUES (?, 0)", ("Profile %d" % profile,))
+        for course in courses:
+            db.execute("INSERT INTO course_progress (profile_id, course_id, type, lesson_id) VALUES (?, ?, 0, ?)",
+                       (profile, course, lessons[course][0]))
+
+    def stats():
+        for i in range(rows):
+            course = rng.choice(courses)
+            yield (rng.randint(1, PROFILES), course, rng.choice(lessons[course]), date + i * 60000,
+                   rng.randint(100, 1000), rng.randint(0, 50), rng.randint(30000, 300000))
+
+    db.executemany("INSERT INTO training_stats (profile_id, course_id, lesson_id, date, characters_typed, error_count, elapsed_time) VALUES (?, ?, ?, ?, ?, ?, ?)", stats())
+
+    def errors():
+        for stats_id in range(1, rows + 1):
+            for character in rng.sample("abcdefghijklmnopqrstuvwxyz", 3):
+                yield (stats_id, character, rng.randint(1, 5))
+
+    db.executemany("INSERT INTO training_stats_errors (stats_id, character, count) VALUES (?, ?, ?)", errors())
+    db.commit()
+    db.close()
+
+    return courses, lessons
+
+
+def migrate(path):
+    db = sqlite3.connect(path)
+    start = time.time()
+    for sql in INDEXES:
+        db.execute(sql)
+    db.execute("UPDATE metadata SET value = '1.2' WHERE key = 'version'")
+    db.commit()
+    db.close()
+    return time.time() - start
+
+
+def time_queries(path, courses, lessons, iterations):
+    db = sqlite3.connect(path)
+    rng = random.Random(23)
+    results = []
+
+    for name, sql, params in QUERIES:
+        plan = " / ".join(row[-1] for row in db.execute("EXPLAIN QUERY PLAN " + sql, params({"profile": 1, "course": "", "lesson": "", "stats": 1})))
+        start = time.time()
+        for i in range(iterations):
+            course = rng.choice(courses)
+            p = {
+                "profile": rng.randint(1, PROFILES),
+                "course": course,
+                "lesson": rng.choice(lessons[course]),
+                "stats": rng.randint(1, 1000),
+            }
+            db.execute(sql, params(p)).fetchall()
+        results.append((name, (time.time() - start) / iterations, plan))
+
+    db.close()
+    return results
+
+
+def queries(args):
+    path = args.database or os.path.join(tempfile.gettempdir(), "ktouch-profiles-benchmark.db")
+
+    print("creating synthetic history with %d training sessions in %s" % (args.rows, path))
+    courses, lessons = create_history(path, args.rows)
+
+    before = time_queries(path, courses, lessons, args.iterations)
+    print("migrating to 1.2: %.2f s" % migrate(path))
+    after = time_queries(path, courses, lessons, args.iterations)
+
+    print()
+    print("%-28s %12s %12s" % ("query", "1.1 (ms)", "1.2 (ms)"))
+    for (name, old, old_plan), (_, new, new_plan) in zip(before, after):
+        print("%-28s %12.3f %12.3f" % (name, old * 1000, new * 1000))
+        if args.verbose:
+            print("    1.1: %s" % old_plan)
+            print("    1.2: %s" % new_plan)
+
+    if not args.database:
+        os.remove(path)
+
+
+def commits(args):
+    path = os.path.join(args.directory or tempfile.gettempdir(), "ktouch-profiles-commits.db")
+    rng = random.Random(42)
+
+    print("%-10s %10s %10s %10s %14s" % ("mode", "mean (ms)", "p50 (ms)", "p99 (ms)", "checkpoint (ms)"))
+
+    for mode, pragmas in STORAGE_MODES:
+        for suffix in ("", "-wal", "-shm", "-journal"):
+            if os.path.exists(path + suffix):
+                os.remove(path + suffix)
+
+        db = sqlite3.connect(path, isolation_level=None)
+
+        for sql in TABLES + INDEXES:
+            db.execute(sql)
+
+        # schema 1.4
+        db.execute("ALTER TABLE training_stats ADD COLUMN errors BLOB")
+
+        for pragma in pragmas:
+            db.execute(pragma).fetchall()
+
+        db.execute("PRAGMA mmap_size = %d" % (args.mmap_size * 1024 * 1024)).fetchall()
+        db.execute("PRAGMA cache_size = -%d" % args.cache_size)
+
+        latencies = []
+
+        # one commit per finished lesson, like TrainingStatsWriter with a
+        # single queued record
+        for i in range(args.commits):
+            start = time.time()
+            errors = [(character, rng.randint(1, 5)) for character in rng.sample("abcdefghijklmnopqrstuvwxyz", 3)]
+            db.execute("BEGIN")
+            db.execute("INSERT INTO training_stats (profile_id, course_id, lesson_id, date, characters_typed, error_count, elapsed_time, errors) VALUES (?, ?, ?, ?, ?, ?, ?, ?)",
+                       (1, "course", "lesson", i, rng.randint(100, 1000), rng.randint(0, 50), rng.randint(30000, 300000), encode_errors(errors)))
+            db.execute("INSERT OR IGNORE INTO profile_summary (profile_id, lessons_trained, total_training_time, last_training_session) VALUES (?, 0, 0, 0)", (1,))
+            db.execute("UPDATE profile_summary SET lessons_trained = lessons_trained + 1, total_training_time = total_training_time + ?, last_training_session = MAX(last_training_session, ?) WHERE profile_id = ?", (60000, i, 1))
+            db.execute("COMMIT")
+            latencies.append(time.time() - start)
+
+        start = time.time()
+        db.execute("PRAGMA wal_checkpoint(TRUNCATE)").fetchall()
+        checkpoint = time.time() - start
+        db.close()
+
+        latencies.sort()
+        mean = sum(latencies) / len(latencies)
+        p50 = latencies[len(latencies) // 2]
+        p99 = latencies[min(len(latencies) - 1, int(len(latencies) * 0.99))]
+        print("%-10s %10.3f %10.3f %10.3f %14.3f" % (mode, mean * 1000, p50 * 1000, p99 * 1000, checkpoint * 1000))
+
+    for suffix in ("", "-wal", "-shm", "-journal"):
+        if os.path.exists(path + suffix):
+            os.remove(path + suffix)
+
+
+KEY_CHAR_POSITIONS = {"hidden": 0, "topLeft": 1, "topRight": 2, "bottomLeft": 3, "bottomRight": 4}
+
+
+def import_keyboard_layout(db, path):
+    """stores a shipped layout like UserDataAccess::storeKeyboardLayout()"""
+    root = etree.parse(path).getroot()
+    layout_id = root.findtext("id")
+    db.execute("INSERT INTO keyboard_layouts (id, title, name, width, height) VALUES (?, ?, ?, ?, ?)",
+               (layout_id, root.findtext("title"), root.findtext("name"), int(root.findtext("width")), int(root.findtext("height"))))
+
+    for node in root.find("keys"):
+        geometry = [int(node.get(attr)) for attr in ("left", "top", "width", "height")]
+        if node.tag == "key":
+            cursor = db.execute("INSERT INTO keyboard_layout_keys (keyboard_layout_id, left, top, width, height, type, finger_index, has_haptic_marker) VALUES (?, ?, ?, ?, ?, 1, ?, ?)",
+                                [layout_id] + geometry + [int(node.get("fingerIndex", 0)), node.get("hasHapticMarker") == "true"])
+            for char in node.findall("char"):
+                db.execute("INSERT INTO keyboard_layout_key_chars (key_id, position, character, modifier) VALUES (?, ?, ?, ?)",
+                           (cursor.lastrowid, KEY_CHAR_POSITIONS[char.get("position")], char.text, char.get("modifier", "")))
+        else:
+            db.execute("INSERT INTO keyboard_layout_keys (keyboard_layout_id, left, top, width, height, type, special_key_type, modifier_id, label) VALUES (?, ?, ?, ?, ?, 2, ?, ?, ?)",
+                       [layout_id] + geometry + [node.get("type"), node.get("modifierId", ""), node.get("label", "")])
+
+    return layout_id
+
+
+def load_keyboard_layout_per_key(db, layout_id):
+    """one key chars query per key, as loadKeyboardLayout() used to do"""
+    keys = []
+    for row in db.execute("SELECT id, left, top, width, height, type, finger_index, has_haptic_marker, special_key_type, modifier_id, label FROM keyboard_layout_keys WHERE keyboard_layout_id = ?", (layout_id,)).fetchall():
+        chars = []
+        if row[5] == 1:
+            chars = db.execute("SELECT position, character, modifier FROM keyboard_layout_key_chars WHERE key_id = ?", (row[0],)).fetchall()
+        keys.append((row, chars))
+    return keys
+
+
+def load_keyboard_layout_joined(db, layout_id):
+    """the single joined query of UserDataAccess::loadKeyboardLayout()"""
+    keys = []
+    current_key_id = None
+    for row in db.execute("SELECT k.id, k.left, k.top, k.width, k.height, k.type, k.finger_index, k.has_haptic_marker, k.special_key_type, k.modifier_id, k.label, c.position, c.character, c.modifier "
+                          "FROM keyboard_layout_keys k LEFT JOIN keyboard_layout_key_chars c ON c.key_id = k.id "
+                          "WHERE k.keyboard_layout_id = ? ORDER BY k.id, c.id", (layout_id,)):
+        if row[0] != current_key_id:
+            keys.append((row[:11], []))
+            current_key_id = row[0]
+        if row[5] == 1 and row[11] is not None:
+            keys[-1][1].append(row[11:])
+    return keys
+
+
+def keyboard_layouts(args):
+    path = os.path.join(tempfile.gettempdir(), "ktouch-profiles-layouts.db")
+    if os.path.exists(path):
+        os.remove(path)
+
+    db = sqlite3.connect(path)
+    for sql in TABLES + INDEXES:
+        db.execute(sql)
+
+    layout_ids = [import_keyboard_layout(db, f) for f in sorted(glob.glob(os.path.join(args.layouts, "*.xml")))]
+    db.commit()
+
+    keys = db.execute("SELECT COUNT(*) FROM keyboard_layout_keys").fetchone()[0]
+    print("imported %d keyboard layouts with %d keys" % (len(layout_ids), keys))
+
+    for layout_id in layout_ids:
+        if load_keyboard_layout_per_key(db, layout_id) != load_keyboard_layout_joined(db, layout_id):
+            print("the loaders disagree on layout %s" % layout_id)
+
+    for name, loader in (("query per key", load_keyboard_layout_per_key), ("joined query", load_keyboard_layout_joined)):
+        start = time.time()
+        for i in range(args.iterations):
+            for layout_id in layout_ids:
+                loader(db, layout_id)
+        elapsed = (time.time() - start) / args.iterations / len(layout_ids)
+        print("%-16s %8.3f ms per layout" % (name, elapsed * 1000))
+
+    db.close()
+    os.remove(path)
+
+
+def simulate_session(minutes, speed, accuracy):
+    keystrokes = []
+    text = "the quick brown fox jumps over the lazy dog "
+    keystroke_time = 0
+    position = 0
+    while keystroke_time < minutes * 60000:
+        keystroke_time += int(random.expovariate(speed / 60000.0))
+        expected = text[position % len(text)]
+        if random.random() < accuracy:
+            keystrokes.append((keystroke_time, expected, expected))
+            position += 1
+        else:
+            keystrokes.append((keystroke_time, expected, random.choice(text.strip())))
+            keystroke_time += int(random.expovariate(speed / 60000.0))
+            keystrokes.append((keystroke_time, None, None))
+    return keystrokes
+
+
+def keystrokes(args):
+    path = os.path.join(tempfile.gettempdir(), "ktouch-profiles-keystrokes.db")
+
+    for name, table in (("row per keystroke", "CREATE TABLE keystrokes (id INTEGER PRIMARY KEY AUTOINCREMENT, stats_id INTEGER, time INTEGER, expected TEXT, typed TEXT, flags INTEGER)"),
+                        ("journal blob", "CREATE TABLE training_stats_keystrokes (stats_id INTEGER PRIMARY KEY, keystrokes BLOB)")):
+        if os.path.exists(path):
+            os.remove(path)
+
+        random.seed(args.seed)
+        db = sqlite3.connect(path)
+        db.execute(table)
+        sessions = [simulate_session(args.minutes, args.speed, args.accuracy) for i in range(args.sessions)]
+        total = sum(len(session) for session in sessions)
+
+        for stats_id, session in enumerate(sessions):
+            if table.startswith("CREATE TABLE keystrokes"):
+                db.executemany("INSERT INTO keystrokes (stats_id, time, expected, typed, flags) VALUES (?, ?, ?, ?, ?)",
+                               ((stats_id, t, e, y, 2 if y is None else int(e != y)) for t, e, y in session))
+            else:
+                db.execute("INSERT INTO training_stats_keystrokes (stats_id, keystrokes) VALUES (?, ?)", (stats_id, sqlite3.Binary(encode_keystrokes(session))))
+            db.commit()
+
+        db.execute("VACUUM")
+        db.close()
+        size = os.path.getsize(path)
+        print("%-18s %8d keystrokes %10.1f KiB per session %6.2f bytes per keystroke" %
+              (name, total, size / 1024.0 / args.sessions, float(size) / total))
+
+    os.remove(path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmarks for the KTouch profile database")
+    subparsers = parser.add_subparsers(dest="command")
+    subparsers.required = True
+
+    queries_parser = subparsers.add_parser("queries", help="time the hot queries before and after the 1.2 indexes")
+    queries_parser.add_argument("--rows", type=int, default=1000000, help="number of synthetic training sessions")
+    queries_parser.add_argument("--iterations", type=int, default=50, help="executions per query")
+    queries_parser.add_argument("--database", help="keep the synthetic database at this path")
+    queries_parser.add_argument("--verbose", action="store_true", help="print the query plans")
+    queries_parser.set_defaults(func=queries)
+
+    commits_parser = subparsers.add_parser("commits", help="compare the commit latency of the storage modes")
+    commits_parser.add_argument("--commits", type=int, default=500, help="number of saved training sessions")
+    commits_parser.add_argument("--mmap-size", type=int, default=64, help="memory mapped I/O size in MiB")
+    commits_parser.add_argument("--cache-size", type=int, default=8192, help="page cache size in KiB")
+    commits_parser.add_argument("--directory", help="directory for the database, should be on the disk under test")
+    commits_parser.set_defaults(func=commits)
+
+    layouts_parser = subparsers.add_parser("keyboard-layouts", help="compare loading the shipped keyboard layouts with and without the joined query")
+    layouts_parser.add_argument("--layouts", default=os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "data", "keyboardlayouts"), help="directory with the keyboard layout files")
+    layouts_parser.add_argument("--iterations", type=int, default=20, help="loads per layout")
+    layouts_parser.set_defaults(func=keyboard_layouts)
+
+    keystrokes_parser = subparsers.add_parser("keystrokes", help="compare storing keystroke journals as blobs with a row per keystroke")
+    keystrokes_parser.add_argument("--sessions", type=int, default=50, help="number of simulated training sessions")
+    keystrokes_parser.add_argument("--minutes", type=int, default=10, help="length of a session in minutes")
+    keystrokes_parser.add_argument("--speed", type=int, default=250, help="keystrokes per minute")
+    keystrokes_parser.add_argument("--accuracy", type=float, default=0.95, help="share of correct keystrokes")
+    keystrokes_parser.add_argument("--seed", type=int, default=1, help="seed of the simulated sessions")
+    keystrokes_parser.set_defaults(func=keystrokes)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
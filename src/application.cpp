@@ -17,6 +17,7 @@
 
 #include "application.h"
 
+#include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QQmlEngine>
@@ -27,6 +28,7 @@
 #include <Kdelibs4Migration>
 #include <KDeclarative/KDeclarative>
 
+#include "preferences.h"
 #include "bindings/utils.h"
 #include "bindings/stringformatter.h"
 #include "declarativeitems/griditem.h"
@@ -42,9 +44,12 @@
 #include "core/lesson.h"
 #include "core/profile.h"
 #include "core/trainingstats.h"
+#include "core/trainingstatswriter.h"
 #include "core/dataindex.h"
+#include "core/dataindexloader.h"
 #include "core/dataaccess.h"
 #include "core/profiledataaccess.h"
+#include "core/userdataaccess.h"
 #include "models/resourcemodel.h"
 #include "models/lessonmodel.h"
 #include "models/categorizedresourcesortfilterproxymodel.h"
@@ -54,13 +59,46 @@
 
 Application::Application(int& argc, char** argv, int flags):
     QApplication(argc, argv, flags),
-    m_dataIndex(new DataIndex(this))
+    m_showStartupTimings(false),
+    m_dataIndex(new DataIndex(this)),
+    m_dataIndexLoader(new DataIndexLoader(this)),
+    m_trainingStatsWriter(new TrainingStatsWriter())
 {
+    m_startupTimer.start();
+
     registerQmlTypes();
     migrateKde4Files();
 
-    DataAccess dataAccess;
-    dataAccess.loadDataIndex(m_dataIndex);
+    // the settings are read by the loader threads as well, make sure they
+    // belong to the GUI thread nonetheless
+    Preferences::self();
+
+    // the schema is checked and migrated only once, here on the connection
+    // of the GUI thread, before other threads open connections of their own
+    UserDataAccess userDataAccess;
+    userDataAccess.openDatabase();
+
+    // the index is filled on the thread pool while the window and the QML
+    // scene are set up, users have to wait for DataIndex::isReady
+    connect(m_dataIndexLoader, SIGNAL(finished()), SLOT(onDataIndexLoaded()));
+    m_dataIndexLoader->load(m_dataIndex);
+
+    recordStartupPhase("application initialized");
+}
+
+Application::~Application()
+{
+    // waits for a data index still being loaded
+    delete m_dataIndexLoader;
+
+    // waits for the pending training stats to be written
+    delete m_trainingStatsWriter;
+
+    // the cached statements of the GUI thread have to go before its
+    // connection, they would otherwise only be freed with the thread storage
+    // after the connection is long gone
+    UserDataAccess userDataAccess;
+    userDataAccess.closeDatabase();
 }
 
 DataIndex* Application::dataIndex()
@@ -70,6 +108,13 @@ DataIndex* Application::dataIndex()
     return app->m_dataIndex;
 }
 
+TrainingStatsWriter* Application::trainingStatsWriter()
+{
+    Application* app = qobject_cast<Application*>(QCoreApplication::instance());
+
+    return app->m_trainingStatsWriter;
+}
+
 QPointer<ResourceEditor>& Application::resourceEditorRef()
 {
     Application* app = qobject_cast<Application*>(QCoreApplication::instance());
@@ -95,11 +140,51 @@ void Application::setupDeclarativeBindings(QQmlEngine* qmlEngine)
     rootContext->setContextProperty("strFormatter", new StringFormatter());
 }
 
+void Application::recordStartupPhase(const QString& phase)
+{
+    Application* app = qobject_cast<Application*>(QCoreApplication::instance());
+
+    app->m_startupPhases.append(qMakePair(phase, app->m_startupTimer.elapsed()));
+
+    if (app->m_showStartupTimings)
+    {
+        app->printStartupPhase(app->m_startupPhases.count() - 1);
+    }
+}
+
 QStringList& Application::qmlImportPaths()
 {
     return m_qmlImportPaths;
 }
 
+void Application::setShowStartupTimings(bool show)
+{
+    if (show && !m_showStartupTimings)
+    {
+        // phases recorded before the command line got parsed
+        for (int i = 0; i < m_startupPhases.count(); i++)
+        {
+            printStartupPhase(i);
+        }
+    }
+
+    m_showStartupTimings = show;
+}
+
+void Application::onDataIndexLoaded()
+{
+    recordStartupPhase(QString("data index ready (built-in resources: %1 ms, user resources: %2 ms, in parallel)")
+        .arg(m_dataIndexLoader->builtInResourcesNSecs() / 1000000)
+        .arg(m_dataIndexLoader->userResourcesNSecs() / 1000000));
+}
+
+void Application::printStartupPhase(int index)
+{
+    const QPair<QString, qint64>& phase = m_startupPhases.at(index);
+
+    qInfo().noquote() << QString("startup: %1 ms %2").arg(phase.second, 6).arg(phase.first);
+}
+
 void Application::registerQmlTypes()
 {
     qmlRegisterType<KeyboardLayout>("ktouch", 1, 0, "KeyboardLayout");
@@ -19,26 +19,41 @@
 #define APPLICATION_H
 
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QPointer>
 
 #include "editor/resourceeditor.h"
 
 class QQmlEngine;
 class DataIndex;
+class DataIndexLoader;
+class TrainingStatsWriter;
 
 class Application : public QApplication
 {
     Q_OBJECT
 public:
     Application(int& argc, char** argv, int flags = ApplicationFlags);
+    ~Application();
     static DataIndex* dataIndex();
+    static TrainingStatsWriter* trainingStatsWriter();
     static void setupDeclarativeBindings(QQmlEngine* qmlEngine);
     static QPointer<ResourceEditor>& resourceEditorRef();
+    static void recordStartupPhase(const QString& phase);
     QStringList& qmlImportPaths();
+    void setShowStartupTimings(bool show);
+private slots:
+    void onDataIndexLoaded();
 private:
     void registerQmlTypes();
     void migrateKde4Files();
+    void printStartupPhase(int index);
+    QElapsedTimer m_startupTimer;
+    QList<QPair<QString, qint64> > m_startupPhases;
+    bool m_showStartupTimings;
     DataIndex* m_dataIndex;
+    DataIndexLoader* m_dataIndexLoader;
+    TrainingStatsWriter* m_trainingStatsWriter;
     QPointer<ResourceEditor> m_resourceEditorRef;
     QStringList m_qmlImportPaths;
 };
@@ -18,7 +18,9 @@
 #include "abstractkey.h"
 
 AbstractKey::AbstractKey(QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    m_storageId(-1),
+    m_isModified(true)
 {
 }
 
@@ -32,6 +34,7 @@ void AbstractKey::setLeft(int left)
     if (left != m_left)
     {
         m_left = left;
+        m_isModified = true;
         emit leftChanged();
     }
 }
@@ -47,6 +50,7 @@ void AbstractKey::setTop(int top)
     if (top != m_top)
     {
         m_top = top;
+        m_isModified = true;
         emit topChanged();
     }
 }
@@ -63,6 +67,7 @@ void AbstractKey::setWidth(int width)
     if (width != m_width)
     {
         m_width = width;
+        m_isModified = true;
         emit widthChanged();
     }
 }
@@ -79,6 +84,7 @@ void AbstractKey::setHeight(int height)
     if (height != m_height)
     {
         m_height = height;
+        m_isModified = true;
         emit heightChanged();
     }
 }
@@ -96,6 +102,26 @@ void AbstractKey::copyFrom(AbstractKey* source)
     setHeight(source->height());
 }
 
+int AbstractKey::storageId() const
+{
+    return m_storageId;
+}
+
+void AbstractKey::setStorageId(int storageId)
+{
+    m_storageId = storageId;
+}
+
+bool AbstractKey::isModified() const
+{
+    return m_isModified;
+}
+
+void AbstractKey::setIsModified(bool isModified)
+{
+    m_isModified = isModified;
+}
+
 QRect AbstractKey::rect() const
 {
     return QRect(left(), top(), width(), height());
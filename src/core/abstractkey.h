@@ -42,6 +42,10 @@ public:
     int height() const;
     void setHeight(int height);
     Q_INVOKABLE void copyFrom(AbstractKey* source);
+    int storageId() const;
+    void setStorageId(int storageId);
+    virtual bool isModified() const;
+    virtual void setIsModified(bool isModified);
 
     QRect rect() const;
     void setRect(const QRect& rect);
@@ -57,6 +61,8 @@ private:
     int m_top;
     int m_width;
     int m_height;
+    int m_storageId;
+    bool m_isModified;
 };
 
 #endif // ABSTRACTKEY_H
@@ -26,7 +26,10 @@ Course::Course(QObject *parent) :
     CourseBase(parent),
     m_associatedDataIndexCourse(0),
     m_doSyncLessonCharacters(true),
-    m_signalMapper(new QSignalMapper(this))
+    m_signalMapper(new QSignalMapper(this)),
+    m_isTrackingChanges(false),
+    m_isModified(true),
+    m_firstMovedLessonIndex(0)
 {
     connect(m_signalMapper, SIGNAL(mapped(int)), SLOT(updateLessonCharacters(int)));
 }
@@ -61,6 +64,12 @@ void Course::setDoSyncLessonCharacters(bool doSync)
 
 void Course::setId(const QString& id)
 {
+    if (id != this->id())
+    {
+        // the stored rows belong to the old ID
+        m_isTrackingChanges = false;
+    }
+
     CourseBase::setId(id);
 
     if (m_associatedDataIndexCourse)
@@ -71,6 +80,11 @@ void Course::setId(const QString& id)
 
 void Course::setTitle(const QString &title)
 {
+    if (title != this->title())
+    {
+        m_isModified = true;
+    }
+
     CourseBase::setTitle(title);
 
     if (m_associatedDataIndexCourse)
@@ -81,6 +95,11 @@ void Course::setTitle(const QString &title)
 
 void Course::setDescription(const QString &description)
 {
+    if (description != this->description())
+    {
+        m_isModified = true;
+    }
+
     CourseBase::setDescription(description);
 
     if (m_associatedDataIndexCourse)
@@ -91,6 +110,11 @@ void Course::setDescription(const QString &description)
 
 void Course::setKeyboardLayoutName(const QString &keyboardLayoutName)
 {
+    if (keyboardLayoutName != this->keyboardLayoutName())
+    {
+        m_isModified = true;
+    }
+
     CourseBase::setKeyboardLayoutName(keyboardLayoutName);
 
     if (m_associatedDataIndexCourse)
@@ -113,6 +137,7 @@ Lesson* Course::lesson(int index) const
 void Course::addLesson(Lesson* lesson)
 {
     emit lessonAboutToBeAdded(lesson, m_lessons.length());
+    m_firstMovedLessonIndex = qMin(m_firstMovedLessonIndex, m_lessons.length());
     m_lessons.append(lesson);
     lesson->setParent(this);
     const int index = m_lessons.length() - 1;
@@ -127,6 +152,7 @@ void Course::insertLesson(int index, Lesson* lesson)
 {
     Q_ASSERT(index >= 0 && index < m_lessons.count());
     emit lessonAboutToBeAdded(lesson, index);
+    m_firstMovedLessonIndex = qMin(m_firstMovedLessonIndex, index);
     m_lessons.insert(index, lesson);
     lesson->setParent(this);
     updateLessonCharacters(index);
@@ -141,6 +167,9 @@ void Course::removeLesson(int index)
     Q_ASSERT(index >= 0 && index < m_lessons.count());
     emit lessonsAboutToBeRemoved(index, index);
     Lesson* const lesson = m_lessons.at(index);
+    m_removedLessonIds.append(lesson->id());
+    if (m_firstMovedLessonIndex > index)
+        m_firstMovedLessonIndex--;
     m_lessons.removeAt(index);
     delete lesson;
     updateLessonCharacters(index);
@@ -154,6 +183,11 @@ void Course::clearLessons()
         return;
 
     emit lessonsAboutToBeRemoved(0, m_lessons.length() - 1);
+    foreach (Lesson* lesson, m_lessons)
+    {
+        m_removedLessonIds.append(lesson->id());
+    }
+    m_firstMovedLessonIndex = 0;
     qDeleteAll(m_lessons);
     m_lessons.clear();
     emit lessonCountChanged();
@@ -175,9 +209,61 @@ void Course::copyFrom(Course* source)
         lesson->copyFrom(source->lesson(i));
         addLesson(lesson);
     }
+    m_isTrackingChanges = false;
     setIsValid(true);
 }
 
+int Course::evictLessonTexts()
+{
+    int count = 0;
+
+    foreach (Lesson* lesson, m_lessons)
+    {
+        if (lesson->evictText())
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+bool Course::isTrackingChanges() const
+{
+    return m_isTrackingChanges;
+}
+
+void Course::startChangeTracking()
+{
+    // from now on the course is assumed to match its stored version, every
+    // later modification is recorded so only it has to be written back
+
+    m_isTrackingChanges = true;
+    m_isModified = false;
+    m_firstMovedLessonIndex = m_lessons.count();
+    m_removedLessonIds.clear();
+
+    foreach (Lesson* lesson, m_lessons)
+    {
+        lesson->setIsModified(false);
+    }
+}
+
+bool Course::isModified() const
+{
+    return m_isModified;
+}
+
+int Course::firstMovedLessonIndex() const
+{
+    return m_firstMovedLessonIndex;
+}
+
+QStringList Course::removedLessonIds() const
+{
+    return m_removedLessonIds;
+}
+
 void Course::updateLessonCharacters(int firstIndex)
 {
     if (!m_doSyncLessonCharacters)
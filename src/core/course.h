@@ -21,6 +21,7 @@
 #include "coursebase.h"
 
 #include <QString>
+#include <QStringList>
 #include <QList>
 
 class QSignalMapper;
@@ -51,6 +52,12 @@ public:
     Q_INVOKABLE void removeLesson(int index);
     Q_INVOKABLE void clearLessons();
     Q_INVOKABLE void copyFrom(Course* source);
+    Q_INVOKABLE int evictLessonTexts();
+    bool isTrackingChanges() const;
+    void startChangeTracking();
+    bool isModified() const;
+    int firstMovedLessonIndex() const;
+    QStringList removedLessonIds() const;
 
 signals:
     void associatedDataIndexCourseChanged();
@@ -70,6 +77,10 @@ private:
     bool m_doSyncLessonCharacters;
     QList<Lesson*> m_lessons;
     QSignalMapper* m_signalMapper;
+    bool m_isTrackingChanges;
+    bool m_isModified;
+    int m_firstMovedLessonIndex;
+    QStringList m_removedLessonIds;
 };
 
 #endif // COURSE_H
@@ -26,22 +26,6 @@ DataAccess::DataAccess(QObject* parent) :
 {
 }
 
-bool DataAccess::loadDataIndex(DataIndex* target)
-{
-    target->setIsValid(false);
-    target->clearCourses();
-    target->clearKeyboardLayouts();
-
-    ResourceDataAccess resourceDataAccess;
-    UserDataAccess userDataAccess;
-
-    const bool valid = resourceDataAccess.fillDataIndex(target) && userDataAccess.fillDataIndex(target);
-
-    target->setIsValid(valid);
-
-    return valid;
-}
-
 bool DataAccess::loadCourse(DataIndexCourse* dataIndexCourse, Course* target)
 {
     ResourceDataAccess resourceDataAccess;
@@ -21,7 +21,6 @@
 #include <QObject>
 
 class Course;
-class DataIndex;
 class DataIndexCourse;
 class DataIndexKeyboardLayout;
 class KeyboardLayout;
@@ -31,7 +30,6 @@ class DataAccess : public QObject
     Q_OBJECT
 public:
     explicit DataAccess(QObject* parent = 0);
-    Q_INVOKABLE bool loadDataIndex(DataIndex* target);
     Q_INVOKABLE bool loadCourse(DataIndexCourse* dataIndexCourse, Course* target);
     Q_INVOKABLE bool loadKeyboardLayout(DataIndexKeyboardLayout* dataIndexKeyboardLayout, KeyboardLayout* target);
 };
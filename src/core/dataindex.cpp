@@ -18,10 +18,25 @@
 #include "dataindex.h"
 
 DataIndex::DataIndex(QObject* parent):
-    Resource(parent)
+    Resource(parent),
+    m_isReady(false)
 {
 }
 
+bool DataIndex::isReady() const
+{
+    return m_isReady;
+}
+
+void DataIndex::setIsReady(bool isReady)
+{
+    if (isReady != m_isReady)
+    {
+        m_isReady = isReady;
+        emit isReadyChanged();
+    }
+}
+
 int DataIndex::courseCount() const
 {
     return m_courses.length();
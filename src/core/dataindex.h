@@ -34,6 +34,7 @@ class DataIndex : public Resource
     Q_OBJECT
     Q_PROPERTY(int courseCount READ courseCount NOTIFY courseCountChanged)
     Q_PROPERTY(int keyboardLayoutCount READ keyboardLayoutCount NOTIFY keyboardLayoutCountChanged)
+    Q_PROPERTY(bool isReady READ isReady WRITE setIsReady NOTIFY isReadyChanged)
     Q_ENUMS(Source)
 
 public:
@@ -42,6 +43,8 @@ public:
         UserResource
     };
     explicit DataIndex(QObject* parent = 0);
+    bool isReady() const;
+    void setIsReady(bool isReady);
     int courseCount() const;
     Q_INVOKABLE DataIndexCourse* course(int index) const;
     Q_INVOKABLE void addCourse(DataIndexCourse* course);
@@ -54,6 +57,7 @@ public:
     Q_INVOKABLE void clearKeyboardLayouts();
 
 signals:
+    void isReadyChanged();
     void courseCountChanged();
     void keyboardLayoutCountChanged();
 
@@ -68,6 +72,7 @@ signals:
     void keyboardLayoutsRemoved();
 
 private:
+    bool m_isReady;
     QList<DataIndexCourse*> m_courses;
     QList<DataIndexKeyboardLayout*> m_keyboardLayouts;
 };
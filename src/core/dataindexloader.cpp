@@ -0,0 +1,153 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "dataindexloader.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#include "core/dataindex.h"
+#include "core/resourcedataaccess.h"
+#include "core/userdataaccess.h"
+
+DataIndexLoader::DataIndexLoader(QObject* parent) :
+    QObject(parent),
+    m_target(0),
+    m_builtInResourcesWatcher(new QFutureWatcher<PartialDataIndex>(this)),
+    m_userResourcesWatcher(new QFutureWatcher<PartialDataIndex>(this)),
+    m_builtInResourcesNSecs(0),
+    m_userResourcesNSecs(0)
+{
+    connect(m_builtInResourcesWatcher, SIGNAL(finished()), SLOT(partialDataIndexLoaded()));
+    connect(m_userResourcesWatcher, SIGNAL(finished()), SLOT(partialDataIndexLoaded()));
+}
+
+DataIndexLoader::~DataIndexLoader()
+{
+    if (isRunning())
+    {
+        m_builtInResourcesWatcher->waitForFinished();
+        m_userResourcesWatcher->waitForFinished();
+        delete m_builtInResourcesWatcher->result().dataIndex;
+        delete m_userResourcesWatcher->result().dataIndex;
+    }
+}
+
+void DataIndexLoader::load(DataIndex* target)
+{
+    Q_ASSERT(!isRunning());
+
+    m_target = target;
+    m_target->setIsReady(false);
+    m_target->setIsValid(false);
+    m_target->clearCourses();
+    m_target->clearKeyboardLayouts();
+
+    m_builtInResourcesWatcher->setFuture(QtConcurrent::run(&DataIndexLoader::loadBuiltInResources, thread()));
+    m_userResourcesWatcher->setFuture(QtConcurrent::run(&DataIndexLoader::loadUserResources, thread()));
+}
+
+bool DataIndexLoader::isRunning() const
+{
+    return m_target != 0;
+}
+
+qint64 DataIndexLoader::builtInResourcesNSecs() const
+{
+    return m_builtInResourcesNSecs;
+}
+
+qint64 DataIndexLoader::userResourcesNSecs() const
+{
+    return m_userResourcesNSecs;
+}
+
+void DataIndexLoader::partialDataIndexLoaded()
+{
+    if (!m_builtInResourcesWatcher->isFinished() || !m_userResourcesWatcher->isFinished())
+        return;
+
+    const PartialDataIndex builtInResources = m_builtInResourcesWatcher->result();
+    const PartialDataIndex userResources = m_userResourcesWatcher->result();
+
+    m_builtInResourcesNSecs = builtInResources.nsecs;
+    m_userResourcesNSecs = userResources.nsecs;
+
+    moveEntries(builtInResources.dataIndex);
+    moveEntries(userResources.dataIndex);
+
+    delete builtInResources.dataIndex;
+    delete userResources.dataIndex;
+
+    DataIndex* const target = m_target;
+    m_target = 0;
+
+    target->setIsValid(builtInResources.isValid && userResources.isValid);
+    target->setIsReady(true);
+
+    emit finished();
+}
+
+DataIndexLoader::PartialDataIndex DataIndexLoader::loadBuiltInResources(QThread* thread)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    PartialDataIndex result;
+    result.dataIndex = new DataIndex();
+
+    ResourceDataAccess resourceDataAccess;
+    result.isValid = resourceDataAccess.fillDataIndex(result.dataIndex);
+
+    result.dataIndex->moveToThread(thread);
+    result.nsecs = timer.nsecsElapsed();
+    return result;
+}
+
+DataIndexLoader::PartialDataIndex DataIndexLoader::loadUserResources(QThread* thread)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    PartialDataIndex result;
+    result.dataIndex = new DataIndex();
+
+    UserDataAccess userDataAccess;
+    result.isValid = userDataAccess.fillDataIndex(result.dataIndex);
+
+    // pool threads come and go, their connections mustn't outlive the task
+    userDataAccess.closeDatabase();
+
+    result.dataIndex->moveToThread(thread);
+    result.nsecs = timer.nsecsElapsed();
+    return result;
+}
+
+void DataIndexLoader::moveEntries(DataIndex* source)
+{
+    for (int i = 0; i < source->courseCount(); i++)
+    {
+        m_target->addCourse(source->course(i));
+    }
+
+    for (int i = 0; i < source->keyboardLayoutCount(); i++)
+    {
+        m_target->addKeyboardLayout(source->keyboardLayout(i));
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DATAINDEXLOADER_H
+#define DATAINDEXLOADER_H
+
+#include <QObject>
+#include <QFutureWatcher>
+
+class QThread;
+class DataIndex;
+
+/**
+ * Fills a DataIndex in the background.
+ *
+ * The built-in resources and the resources in the user database are read
+ * concurrently on the global thread pool, each into an index of its own.
+ * Once both are done their entries are handed over to the target in the
+ * GUI thread, built-in resources first, and the target is marked as ready.
+ */
+class DataIndexLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DataIndexLoader(QObject* parent = 0);
+    ~DataIndexLoader();
+    void load(DataIndex* target);
+    bool isRunning() const;
+    qint64 builtInResourcesNSecs() const;
+    qint64 userResourcesNSecs() const;
+
+signals:
+    void finished();
+
+private slots:
+    void partialDataIndexLoaded();
+
+private:
+    struct PartialDataIndex
+    {
+        DataIndex* dataIndex;
+        bool isValid;
+        qint64 nsecs;
+    };
+
+    static PartialDataIndex loadBuiltInResources(QThread* thread);
+    static PartialDataIndex loadUserResources(QThread* thread);
+    void moveEntries(DataIndex* source);
+    DataIndex* m_target;
+    QFutureWatcher<PartialDataIndex>* m_builtInResourcesWatcher;
+    QFutureWatcher<PartialDataIndex>* m_userResourcesWatcher;
+    qint64 m_builtInResourcesNSecs;
+    qint64 m_userResourcesNSecs;
+};
+
+#endif // DATAINDEXLOADER_H
@@ -17,16 +17,72 @@
 
 #include "dbaccess.h"
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QThread>
+#include <QThreadStorage>
 #include <QUuid>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QStandardPaths>
+#include <QStringList>
 
 #include <KLocalizedString>
 
+#include "core/errorhistogram.h"
+#include "preferences.h"
+
+Q_LOGGING_CATEGORY(dbTiming, "ktouch.timing.db", QtWarningMsg)
+
+// prepared statements by their SQL, shared by all DbAccess instances of a
+// thread since they all use the same connection
+struct QueryCache
+{
+    QueryCache() :
+        hits(0),
+        misses(0),
+        prepareNSecs(0)
+    {
+    }
+
+    QHash<QString, QSqlQuery> queries;
+    int hits;
+    int misses;
+    qint64 prepareNSecs;
+};
+
+static QThreadStorage<QueryCache> queryCache;
+
+// writers block readers on other connections only for the duration of a
+// commit, wait for them instead of failing right away
+static const char* DbConnectOptions = "QSQLITE_BUSY_TIMEOUT=5000";
+
+static const char* DbSchemaVersion = "1.6";
+
+// the indexes for the queries of ProfileDataAccess and UserDataAccess, most
+// of them cover all the columns read so the tables aren't touched at all
+static const char* dbIndexes[] = {
+    "CREATE INDEX IF NOT EXISTS training_stats_lesson_index ON training_stats "
+        "(profile_id, course_id, lesson_id, date, characters_typed, error_count, elapsed_time)",
+    "CREATE INDEX IF NOT EXISTS training_stats_date_index ON training_stats "
+        "(profile_id, date)",
+    "CREATE INDEX IF NOT EXISTS course_progress_index ON course_progress "
+        "(profile_id, course_id, type, lesson_id)",
+    "CREATE INDEX IF NOT EXISTS custom_lessons_profile_index ON custom_lessons "
+        "(profile_id, keyboard_layout_name)",
+    "CREATE INDEX IF NOT EXISTS course_lessons_course_index ON course_lessons "
+        "(course_id)",
+    "CREATE INDEX IF NOT EXISTS keyboard_layout_keys_layout_index ON keyboard_layout_keys "
+        "(keyboard_layout_id)",
+    "CREATE INDEX IF NOT EXISTS keyboard_layout_key_chars_key_index ON keyboard_layout_key_chars "
+        "(key_id)",
+    0
+};
 
 DbAccess::DbAccess(QObject* parent) :
     QObject(parent),
@@ -41,7 +97,9 @@ QString DbAccess::errorMessage() const
 
 QSqlDatabase DbAccess::database()
 {
-    if (!QSqlDatabase::contains(QSqlDatabase::defaultConnection))
+    const QString connectionName = databaseConnectionName();
+
+    if (!QSqlDatabase::contains(connectionName))
     {
         QDir dataDir = QDir(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
         if (!dataDir.exists())
@@ -49,8 +107,9 @@ QSqlDatabase DbAccess::database()
             dataDir.mkpath(dataDir.path());
         }
         QString dbPath = dataDir.filePath("profiles.db");
-        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
         db.setDatabaseName(dbPath);
+        db.setConnectOptions(DbConnectOptions);
         if (!db.open())
         {
             qWarning() << db.lastError().text();
@@ -58,15 +117,130 @@ QSqlDatabase DbAccess::database()
             return db;
         }
 
-        if (!checkDbSchema())
+        applyStorageSettings(db);
+
+        if (!checkDbSchema(db))
         {
+            clearQueryCache();
             db.close();
         }
 
         return db;
     }
 
-    return QSqlDatabase::database(QSqlDatabase::defaultConnection);
+    return QSqlDatabase::database(connectionName);
+}
+
+bool DbAccess::openDatabase()
+{
+    return database().isOpen();
+}
+
+void DbAccess::closeDatabase()
+{
+    const QString connectionName = databaseConnectionName();
+
+    clearQueryCache();
+
+    if (QSqlDatabase::contains(connectionName))
+    {
+        QSqlDatabase::database(connectionName, false).close();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+QString DbAccess::databaseConnectionName()
+{
+    // SQLite connections can't be shared between threads, every thread other
+    // than the GUI thread gets a connection of its own
+    if (QThread::currentThread() == QCoreApplication::instance()->thread())
+        return QLatin1String(QSqlDatabase::defaultConnection);
+
+    return QStringLiteral("ktouch-%1").arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+}
+
+bool DbAccess::prepareQuery(QSqlQuery& query, const QString& sql)
+{
+    QueryCache& cache = queryCache.localData();
+    QHash<QString, QSqlQuery>::const_iterator it = cache.queries.constFind(sql);
+
+    if (it != cache.queries.constEnd())
+    {
+        cache.hits++;
+        query = it.value();
+
+        // a SELECT the last user didn't read to the end still holds its
+        // read transaction, which blocks writers and WAL checkpoints
+        query.finish();
+
+        return true;
+    }
+
+    QSqlDatabase db = database();
+
+    if (!db.isOpen())
+    {
+        query = QSqlQuery(db);
+        return query.prepare(sql);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    query = QSqlQuery(db);
+
+    if (!query.prepare(sql))
+        return false;
+
+    cache.misses++;
+    cache.prepareNSecs += timer.nsecsElapsed();
+    cache.queries.insert(sql, query);
+
+    qCDebug(dbTiming) << "statement cache:" << cache.hits << "hits," << cache.misses << "misses," << cache.prepareNSecs / 1000 << "us spent preparing";
+
+    return true;
+}
+
+void DbAccess::clearQueryCache()
+{
+    if (queryCache.hasLocalData())
+    {
+        queryCache.localData().queries.clear();
+    }
+}
+
+void DbAccess::applyStorageSettings(QSqlDatabase& db)
+{
+    QStringList pragmas;
+
+    switch (Preferences::databaseStorageMode())
+    {
+    case Preferences::EnumDatabaseStorageMode::SafeStorage:
+        pragmas << "PRAGMA journal_mode = DELETE" << "PRAGMA synchronous = FULL";
+        break;
+    case Preferences::EnumDatabaseStorageMode::FastStorage:
+        pragmas << "PRAGMA journal_mode = WAL" << "PRAGMA synchronous = OFF";
+        break;
+    default:
+        // in WAL mode commits with synchronous = NORMAL don't sync at all,
+        // only checkpoints do, and a power loss can't corrupt the database
+        pragmas << "PRAGMA journal_mode = WAL" << "PRAGMA synchronous = NORMAL";
+        break;
+    }
+
+    pragmas << QString("PRAGMA mmap_size = %1").arg(qint64(Preferences::databaseMemoryMapSize()) * 1024 * 1024);
+    pragmas << QString("PRAGMA cache_size = -%1").arg(Preferences::databaseCacheSize());
+
+    foreach (const QString& pragma, pragmas)
+    {
+        db.exec(pragma);
+
+        // the database is still usable with the defaults, it is only slower
+        if (db.lastError().isValid())
+        {
+            qWarning() << pragma << db.lastError().text();
+        }
+    }
 }
 
 void DbAccess::raiseError(const QSqlError& error)
@@ -75,10 +249,8 @@ void DbAccess::raiseError(const QSqlError& error)
     emit errorMessageChanged();
 }
 
-bool DbAccess::checkDbSchema()
+bool DbAccess::checkDbSchema(QSqlDatabase& db)
 {
-    QSqlDatabase db = QSqlDatabase::database();
-
     db.exec("CREATE TABLE IF NOT EXISTS metadata ("
             "key TEXT PRIMARY KEY, "
             "value TEXT"
@@ -100,46 +272,21 @@ bool DbAccess::checkDbSchema()
         return false;
     }
 
+    QString version;
+
     if (versionQuery.next())
     {
-        QString version = versionQuery.value(0).toString();
+        version = versionQuery.value(0).toString();
 
         versionQuery.clear();
 
-        if (version == "1.0")
-        {
-            return migrateFrom1_0To1_1();
-        }
-
-        if (version != "1.1")
+        if (version != "1.0" && version != "1.1" && version != "1.2" && version != "1.3" && version != "1.4" && version != "1.5" && version != DbSchemaVersion)
         {
             m_errorMessage = i18n("Invalid database version '%1'.", version);
             emit errorMessageChanged();
             return false;
         }
     }
-    else
-    {
-        if (!db.transaction())
-        {
-            qWarning() <<  db.lastError().text();
-            raiseError(db.lastError());
-            return false;
-        }
-        db.exec("INSERT INTO metadata (key, value) VALUES ('version', '1.1')");
-        if (db.lastError().isValid())
-        {
-            qWarning() << db.lastError().text();
-            raiseError(db.lastError());
-            return false;
-        }
-        if (!db.commit())
-        {
-            qWarning() << db.lastError().text();
-            raiseError(db.lastError());
-            return false;
-        }
-    }
 
     db.exec("CREATE TABLE IF NOT EXISTS profiles ("
             "id INTEGER PRIMARY KEY AUTOINCREMENT, "
@@ -163,7 +310,20 @@ bool DbAccess::checkDbSchema()
             "date INT, "
             "characters_typed INTEGER, "
             "error_count INTEGER, "
-            "elapsed_time INTEGER "
+            "elapsed_time INTEGER, "
+            "errors BLOB "
+            ")");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        return false;
+    }
+
+    db.exec("CREATE TABLE IF NOT EXISTS training_stats_keystrokes ("
+            "stats_id INTEGER PRIMARY KEY, "
+            "keystrokes BLOB "
             ")");
 
     if (db.lastError().isValid())
@@ -173,11 +333,36 @@ bool DbAccess::checkDbSchema()
         return false;
     }
 
-    db.exec("CREATE TABLE IF NOT EXISTS training_stats_errors ("
+    // daily and weekly totals of sessions older than the detailed history,
+    // the unique constraint indexes them for the charts as well
+    db.exec("CREATE TABLE IF NOT EXISTS training_stats_rollups ("
             "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-            "stats_id INTEGER, "
-            "character TEXT, "
-            "count INTEGER "
+            "profile_id INTEGER, "
+            "course_id TEXT, "
+            "lesson_id TEXT, "
+            "period INTEGER, "
+            "date INT, "
+            "session_count INTEGER, "
+            "characters_typed INTEGER, "
+            "error_count INTEGER, "
+            "elapsed_time INTEGER, "
+            "min_speed INTEGER, "
+            "max_speed INTEGER, "
+            "UNIQUE (profile_id, course_id, lesson_id, period, date) "
+            ")");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        return false;
+    }
+
+    db.exec("CREATE TABLE IF NOT EXISTS profile_summary ("
+            "profile_id INTEGER PRIMARY KEY, "
+            "lessons_trained INTEGER, "
+            "total_training_time INTEGER, "
+            "last_training_session INTEGER "
             ")");
 
     if (db.lastError().isValid())
@@ -298,13 +483,139 @@ bool DbAccess::checkDbSchema()
         return false;
     }
 
+    // bring databases of older versions up to date, one version at a time
+
+    if (version == "1.0")
+    {
+        if (!migrateFrom1_0To1_1(db))
+            return false;
+
+        version = "1.1";
+    }
+
+    if (version == "1.1")
+    {
+        if (!migrateFrom1_1To1_2(db))
+            return false;
+
+        version = "1.2";
+    }
+
+    if (version == "1.2")
+    {
+        if (!migrateFrom1_2To1_3(db))
+            return false;
+
+        version = "1.3";
+    }
+
+    if (version == "1.3")
+    {
+        if (!migrateFrom1_3To1_4(db))
+            return false;
+
+        version = "1.4";
+    }
+
+    if (version == "1.4")
+    {
+        if (!migrateFrom1_4To1_5(db))
+            return false;
+
+        version = "1.5";
+    }
+
+    if (version == "1.5")
+    {
+        if (!migrateFrom1_5To1_6(db))
+            return false;
+
+        version = "1.6";
+    }
+
+    if (version.isNull())
+    {
+        if (!db.transaction())
+        {
+            qWarning() <<  db.lastError().text();
+            raiseError(db.lastError());
+            return false;
+        }
+
+        db.exec(QString("INSERT INTO metadata (key, value) VALUES ('version', '%1')").arg(DbSchemaVersion));
+
+        if (db.lastError().isValid())
+        {
+            qWarning() << db.lastError().text();
+            raiseError(db.lastError());
+            db.rollback();
+            return false;
+        }
+
+        if (!createIndexes(db))
+        {
+            db.rollback();
+            return false;
+        }
+
+        if (!db.commit())
+        {
+            qWarning() << db.lastError().text();
+            raiseError(db.lastError());
+            db.rollback();
+            return false;
+        }
+    }
+
     return true;
 }
 
-bool DbAccess::migrateFrom1_0To1_1()
+bool DbAccess::createIndexes(QSqlDatabase& db)
 {
-    QSqlDatabase db = QSqlDatabase::database();
+    for (int i = 0; dbIndexes[i]; i++)
+    {
+        db.exec(dbIndexes[i]);
 
+        if (db.lastError().isValid())
+        {
+            qWarning() << db.lastError().text();
+            raiseError(db.lastError());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DbAccess::rebuildProfileSummary(QSqlDatabase& db)
+{
+    // profile_summary is kept up to date by every write to training_stats,
+    // this recomputes it from scratch for databases without it
+
+    db.exec("DELETE FROM profile_summary");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        return false;
+    }
+
+    db.exec("INSERT INTO profile_summary (profile_id, lessons_trained, total_training_time, last_training_session) "
+            "SELECT profile_id, COUNT(*), SUM(elapsed_time), MAX(date) FROM training_stats GROUP BY profile_id");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        return false;
+    }
+
+    return true;
+}
+
+bool DbAccess::migrateFrom1_0To1_1(QSqlDatabase& db)
+{
     if (!db.transaction())
     {
         qWarning() <<  db.lastError().text();
@@ -420,3 +731,226 @@ bool DbAccess::migrateFrom1_0To1_1()
 
     return true;
 }
+
+bool DbAccess::migrateFrom1_1To1_2(QSqlDatabase& db)
+{
+    if (!db.transaction())
+    {
+        qWarning() <<  db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    if (!createIndexes(db))
+    {
+        db.rollback();
+        return false;
+    }
+
+    db.exec("UPDATE metadata SET value = '1.2' WHERE key = 'version'");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    if (!db.commit())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    return true;
+}
+
+bool DbAccess::migrateFrom1_2To1_3(QSqlDatabase& db)
+{
+    if (!db.transaction())
+    {
+        qWarning() <<  db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    if (!rebuildProfileSummary(db))
+    {
+        db.rollback();
+        return false;
+    }
+
+    db.exec("UPDATE metadata SET value = '1.3' WHERE key = 'version'");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    if (!db.commit())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    return true;
+}
+
+bool DbAccess::migrateFrom1_3To1_4(QSqlDatabase& db)
+{
+    if (!db.transaction())
+    {
+        qWarning() <<  db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    db.exec("ALTER TABLE training_stats ADD COLUMN errors BLOB");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    QSqlQuery updateQuery(db);
+
+    if (!updateQuery.prepare("UPDATE training_stats SET errors = ? WHERE id = ?"))
+    {
+        qWarning() << updateQuery.lastError().text();
+        raiseError(updateQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    QSqlQuery errorsQuery = db.exec("SELECT stats_id, character, count FROM training_stats_errors ORDER BY stats_id, count DESC");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    // the rows of one training session are adjacent, its histogram is
+    // written out as soon as the rows of the next one start
+
+    ErrorHistogram errorHistogram;
+    int statsId = -1;
+    bool hasRow;
+
+    do
+    {
+        hasRow = errorsQuery.next();
+        const int rowStatsId = hasRow? errorsQuery.value(0).toInt(): -1;
+
+        if (rowStatsId != statsId && statsId != -1)
+        {
+            updateQuery.bindValue(0, errorHistogram.toByteArray());
+            updateQuery.bindValue(1, statsId);
+
+            if (!updateQuery.exec())
+            {
+                qWarning() << updateQuery.lastError().text();
+                raiseError(updateQuery.lastError());
+                db.rollback();
+                return false;
+            }
+
+            errorHistogram.clear();
+        }
+
+        statsId = rowStatsId;
+
+        if (hasRow)
+        {
+            const QString character = errorsQuery.value(1).toString();
+
+            if (!character.isEmpty())
+            {
+                errorHistogram.insert(character.at(0).unicode(), errorsQuery.value(2).toInt());
+            }
+        }
+    }
+    while (hasRow);
+
+    errorsQuery.finish();
+
+    db.exec("DROP TABLE training_stats_errors");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    db.exec("UPDATE metadata SET value = '1.4' WHERE key = 'version'");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    if (!db.commit())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    return true;
+}
+
+bool DbAccess::migrateFrom1_4To1_5(QSqlDatabase& db)
+{
+    // training_stats_keystrokes has already been created by checkDbSchema(),
+    // sessions recorded before it simply have no journal
+
+    db.exec("UPDATE metadata SET value = '1.5' WHERE key = 'version'");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        return false;
+    }
+
+    return true;
+}
+
+bool DbAccess::migrateFrom1_5To1_6(QSqlDatabase& db)
+{
+    // training_stats_rollups has already been created by checkDbSchema(),
+    // the writer fills it with the old sessions in the background
+
+    db.exec("UPDATE metadata SET value = '1.6' WHERE key = 'version'");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        raiseError(db.lastError());
+        return false;
+    }
+
+    return true;
+}
@@ -19,9 +19,13 @@
 #define DBACCESS_H
 
 #include <QObject>
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(dbTiming)
 
 class QSqlDatabase;
 class QSqlError;
+class QSqlQuery;
 
 class DbAccess : public QObject
 {
@@ -30,16 +34,29 @@ class DbAccess : public QObject
 public:
     explicit DbAccess(QObject* parent = 0);
     QString errorMessage() const;
+    bool openDatabase();
+    void closeDatabase();
 
 signals:
     void errorMessageChanged();
 
 protected:
     QSqlDatabase database();
+    bool prepareQuery(QSqlQuery& query, const QString& sql);
     void raiseError(const QSqlError& error);
 private:
-    bool checkDbSchema();
-    bool migrateFrom1_0To1_1();
+    static QString databaseConnectionName();
+    static void applyStorageSettings(QSqlDatabase& db);
+    static void clearQueryCache();
+    bool checkDbSchema(QSqlDatabase& db);
+    bool createIndexes(QSqlDatabase& db);
+    bool rebuildProfileSummary(QSqlDatabase& db);
+    bool migrateFrom1_0To1_1(QSqlDatabase& db);
+    bool migrateFrom1_1To1_2(QSqlDatabase& db);
+    bool migrateFrom1_2To1_3(QSqlDatabase& db);
+    bool migrateFrom1_3To1_4(QSqlDatabase& db);
+    bool migrateFrom1_4To1_5(QSqlDatabase& db);
+    bool migrateFrom1_5To1_6(QSqlDatabase& db);
     QString m_errorMessage;
 };
 
@@ -0,0 +1,329 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "errorhistogram.h"
+
+#include <climits>
+
+#include "varint.h"
+
+// code points are put into the dense table as long as it doesn't span more
+// than this, which covers the characters of any single script
+static const uint MaximumDenseRange = 1024;
+static const uint DenseRangeGranularity = 64;
+
+static const char EncodingVersion = 1;
+
+ErrorHistogram::ErrorHistogram() :
+    m_denseFirst(0),
+    m_totalCount(0)
+{
+    m_entries.reserve(128);
+}
+
+int ErrorHistogram::size() const
+{
+    return m_entries.count();
+}
+
+bool ErrorHistogram::isEmpty() const
+{
+    return m_entries.isEmpty();
+}
+
+int ErrorHistogram::totalCount() const
+{
+    return m_totalCount;
+}
+
+uint ErrorHistogram::codepointAt(int rank) const
+{
+    return m_entries.at(rank).codepoint;
+}
+
+int ErrorHistogram::countAt(int rank) const
+{
+    return m_entries.at(rank).count;
+}
+
+int ErrorHistogram::countOf(uint codepoint) const
+{
+    const int rank = rankOf(codepoint);
+    return rank == -1? 0: m_entries.at(rank).count;
+}
+
+int ErrorHistogram::rankOf(uint codepoint) const
+{
+    if (codepoint >= m_denseFirst && codepoint - m_denseFirst < uint(m_denseRanks.count()))
+    {
+        return m_denseRanks.at(codepoint - m_denseFirst) - 1;
+    }
+
+    return m_sparseRanks.value(codepoint, -1);
+}
+
+int ErrorHistogram::increment(uint codepoint)
+{
+    m_totalCount++;
+
+    int rank = rankOf(codepoint);
+
+    if (rank == -1)
+    {
+        // a count of one can't be ranked higher than any existing entry
+
+        Entry entry;
+        entry.codepoint = codepoint;
+        entry.count = 1;
+        m_entries.append(entry);
+        rank = m_entries.count() - 1;
+        setRank(codepoint, rank);
+        return rank;
+    }
+
+    // the entry moves in front of all entries that had the same count
+
+    const int newRank = tieBlockStart(rank);
+    m_entries[rank].count++;
+    swapEntries(rank, newRank);
+
+    return newRank;
+}
+
+void ErrorHistogram::insert(uint codepoint, int count)
+{
+    const int rank = rankOf(codepoint);
+
+    if (rank != -1)
+    {
+        m_totalCount -= m_entries.at(rank).count;
+        m_entries[rank].count = 0;
+
+        // move the now empty entry to the end and drop it
+
+        for (int i = rank; i < m_entries.count() - 1; i++)
+        {
+            swapEntries(i, i + 1);
+        }
+
+        m_entries.removeLast();
+        setRank(codepoint, -1);
+    }
+
+    if (count <= 0)
+        return;
+
+    Entry entry;
+    entry.codepoint = codepoint;
+    entry.count = count;
+    m_entries.append(entry);
+    setRank(codepoint, m_entries.count() - 1);
+    m_totalCount += count;
+
+    for (int i = m_entries.count() - 1; i > 0 && m_entries.at(i - 1).count < count; i--)
+    {
+        swapEntries(i - 1, i);
+    }
+}
+
+void ErrorHistogram::reserve(const QString& characters)
+{
+    // makes room for the entries of the characters, so counting them later
+    // doesn't have to allocate; only characters too far outside the dense
+    // range for it to cover them still do, when they are put into the hash
+
+    int missing = 0;
+
+    for (int i = 0; i < characters.length(); i++)
+    {
+        const uint codepoint = characters.at(i).unicode();
+
+        if (rankOf(codepoint) != -1)
+            continue;
+
+        missing++;
+
+        if (codepoint < m_denseFirst || codepoint - m_denseFirst >= uint(m_denseRanks.count()))
+        {
+            growDenseRange(codepoint);
+        }
+    }
+
+    const int required = m_entries.count() + missing;
+
+    if (m_entries.capacity() < required)
+    {
+        m_entries.reserve(qMax(required, 2 * m_entries.capacity()));
+    }
+}
+
+void ErrorHistogram::clear()
+{
+    // keep the allocated memory around for the next training session
+
+    m_entries.resize(0);
+    m_denseRanks.fill(0);
+    m_sparseRanks.clear();
+    m_totalCount = 0;
+}
+
+QByteArray ErrorHistogram::toByteArray() const
+{
+    if (m_entries.isEmpty())
+        return QByteArray();
+
+    QByteArray data;
+    data.reserve(1 + m_entries.count() * 3);
+    data.append(EncodingVersion);
+
+    foreach (const Entry& entry, m_entries)
+    {
+        appendVarint(data, entry.codepoint);
+        appendVarint(data, entry.count);
+    }
+
+    return data;
+}
+
+bool ErrorHistogram::fromByteArray(const QByteArray& data)
+{
+    clear();
+
+    if (data.isEmpty())
+        return true;
+
+    if (data.at(0) != EncodingVersion)
+        return false;
+
+    const char* pos = data.constData() + 1;
+    const char* end = data.constData() + data.size();
+
+    while (pos != end)
+    {
+        quint64 codepoint;
+        quint64 count;
+
+        if (!readVarint(pos, end, codepoint) || !readVarint(pos, end, count) || codepoint > 0x10ffff || count > INT_MAX)
+        {
+            clear();
+            return false;
+        }
+
+        // the entries come in rank order, so this only ever appends
+        insert(codepoint, count);
+    }
+
+    return true;
+}
+
+int ErrorHistogram::tieBlockStart(int rank) const
+{
+    const int count = m_entries.at(rank).count;
+    int first = 0;
+    int last = rank;
+
+    while (first < last)
+    {
+        const int middle = (first + last) / 2;
+
+        if (m_entries.at(middle).count > count)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    return first;
+}
+
+void ErrorHistogram::swapEntries(int rank1, int rank2)
+{
+    if (rank1 == rank2)
+        return;
+
+    const Entry entry = m_entries.at(rank1);
+    m_entries[rank1] = m_entries.at(rank2);
+    m_entries[rank2] = entry;
+
+    setRank(m_entries.at(rank1).codepoint, rank1);
+    setRank(m_entries.at(rank2).codepoint, rank2);
+}
+
+void ErrorHistogram::setRank(uint codepoint, int rank)
+{
+    const bool dense = codepoint >= m_denseFirst && codepoint - m_denseFirst < uint(m_denseRanks.count());
+
+    if (dense || (!m_sparseRanks.contains(codepoint) && rank != -1 && growDenseRange(codepoint)))
+    {
+        m_denseRanks[codepoint - m_denseFirst] = rank + 1;
+    }
+    else if (rank == -1)
+    {
+        m_sparseRanks.remove(codepoint);
+    }
+    else
+    {
+        m_sparseRanks.insert(codepoint, rank);
+    }
+}
+
+bool ErrorHistogram::growDenseRange(uint codepoint)
+{
+    if (codepoint > 0xffff)
+        return false;
+
+    const uint oldFirst = m_denseFirst;
+    const uint oldCount = m_denseRanks.count();
+    const uint first = oldCount == 0? codepoint: qMin(oldFirst, codepoint);
+    const uint last = oldCount == 0? codepoint: qMax(oldFirst + oldCount - 1, codepoint);
+    const uint alignedFirst = first - first % DenseRangeGranularity;
+    const uint alignedLast = last - last % DenseRangeGranularity + DenseRangeGranularity - 1;
+
+    if (alignedLast - alignedFirst + 1 > MaximumDenseRange)
+        return false;
+
+    QVector<int> denseRanks(alignedLast - alignedFirst + 1, 0);
+
+    for (uint i = 0; i < oldCount; i++)
+    {
+        denseRanks[oldFirst - alignedFirst + i] = m_denseRanks.at(i);
+    }
+
+    m_denseRanks = denseRanks;
+    m_denseFirst = alignedFirst;
+
+    // characters kept in the hash so far might be covered now
+
+    QMutableHashIterator<uint, int> sparseIterator(m_sparseRanks);
+
+    while (sparseIterator.hasNext())
+    {
+        sparseIterator.next();
+
+        if (sparseIterator.key() >= alignedFirst && sparseIterator.key() <= alignedLast)
+        {
+            m_denseRanks[sparseIterator.key() - alignedFirst] = sparseIterator.value() + 1;
+            sparseIterator.remove();
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,74 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef ERRORHISTOGRAM_H
+#define ERRORHISTOGRAM_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * Counts typing errors per character.
+ *
+ * The entries are kept ordered by their error count, most frequent first,
+ * so the top errors can be read without sorting. Characters are looked up
+ * in a dense table covering the range of code points seen so far, with a
+ * hash as fallback for characters far outside that range.
+ *
+ * For storage the histogram is encoded as a version byte followed by
+ * varint encoded code point and count pairs in rank order.
+ */
+class ErrorHistogram
+{
+public:
+    ErrorHistogram();
+    int size() const;
+    bool isEmpty() const;
+    int totalCount() const;
+    uint codepointAt(int rank) const;
+    int countAt(int rank) const;
+    int countOf(uint codepoint) const;
+    int rankOf(uint codepoint) const;
+    int increment(uint codepoint);
+    void insert(uint codepoint, int count);
+    void reserve(const QString& characters);
+    void clear();
+    QByteArray toByteArray() const;
+    bool fromByteArray(const QByteArray& data);
+
+private:
+    struct Entry
+    {
+        uint codepoint;
+        int count;
+    };
+
+    int tieBlockStart(int rank) const;
+    void swapEntries(int rank1, int rank2);
+    void setRank(uint codepoint, int rank);
+    bool growDenseRange(uint codepoint);
+    QVector<Entry> m_entries;
+    QVector<int> m_denseRanks;
+    uint m_denseFirst;
+    QHash<uint, int> m_sparseRanks;
+    int m_totalCount;
+};
+
+#endif // ERRORHISTOGRAM_H
@@ -43,6 +43,7 @@ void Key::setFingerIndex(int finger)
     if(finger != m_fingerIndex)
     {
         m_fingerIndex = finger;
+        AbstractKey::setIsModified(true);
         emit fingerIndexChanged();
     }
 }
@@ -57,6 +58,7 @@ void Key::setHasHapticMarker(bool hasHapticMarker)
     if(hasHapticMarker != m_hasHapticMarker)
     {
         m_hasHapticMarker = hasHapticMarker;
+        AbstractKey::setIsModified(true);
         emit hasHapticMarkerChanged();
     }
 }
@@ -77,6 +79,7 @@ void Key::addKeyChar(KeyChar* keyChar)
     emit keyCharAboutToBeAdded(keyChar, m_keyChars.length());
     m_keyChars.append(keyChar);
     keyChar->setParent(this);
+    AbstractKey::setIsModified(true);
     emit keyCharCountChanged();
     emit keyCharAdded();
 }
@@ -87,6 +90,7 @@ void Key::insertKeyChar(int index, KeyChar* keyChar)
     emit keyCharAboutToBeAdded(keyChar, index);
     m_keyChars.insert(index, keyChar);
     keyChar->setParent(this);
+    AbstractKey::setIsModified(true);
     emit keyCharCountChanged();
     emit keyCharAdded();
 }
@@ -97,6 +101,7 @@ void Key::removeKeyChar(int index)
     emit keyCharsAboutToBeRemoved(index, index);
     delete m_keyChars.at(index);
     m_keyChars.removeAt(index);
+    AbstractKey::setIsModified(true);
     emit keyCharCountChanged();
     emit keyCharsRemoved();
 }
@@ -109,6 +114,7 @@ void Key::clearKeyChars()
     emit keyCharsAboutToBeRemoved(0, m_keyChars.length() - 1);
     qDeleteAll(m_keyChars);
     m_keyChars.clear();
+    AbstractKey::setIsModified(true);
     emit keyCharCountChanged();
     emit keyCharsRemoved();
 }
@@ -125,3 +131,27 @@ void Key::copyFrom(Key* source)
         addKeyChar(keyChar);
     }
 }
+
+bool Key::isModified() const
+{
+    if (AbstractKey::isModified())
+        return true;
+
+    foreach (KeyChar* keyChar, m_keyChars)
+    {
+        if (keyChar->isModified())
+            return true;
+    }
+
+    return false;
+}
+
+void Key::setIsModified(bool isModified)
+{
+    AbstractKey::setIsModified(isModified);
+
+    foreach (KeyChar* keyChar, m_keyChars)
+    {
+        keyChar->setIsModified(isModified);
+    }
+}
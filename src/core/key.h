@@ -45,6 +45,8 @@ public:
     Q_INVOKABLE void removeKeyChar(int index);
     Q_INVOKABLE void clearKeyChars();
     Q_INVOKABLE void copyFrom(Key* source);
+    bool isModified() const;
+    void setIsModified(bool isModified);
 
 signals:
     void fingerIndexChanged();
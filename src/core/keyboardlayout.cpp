@@ -41,7 +41,10 @@ KeyboardLayout::KeyboardLayout(QObject *parent) :
     m_height(0),
     m_keys(QList<AbstractKey*>()),
     m_referenceKey(0),
-    m_signalMapper(new QSignalMapper(this))
+    m_signalMapper(new QSignalMapper(this)),
+    m_isTrackingChanges(false),
+    m_isModified(true),
+    m_firstMovedKeyIndex(0)
 {
     connect(m_signalMapper, SIGNAL(mapped(int)), SLOT(onKeyGeometryChanged(int)));
 }
@@ -62,6 +65,12 @@ void KeyboardLayout::setAssociatedDataIndexKeyboardLayout(DataIndexKeyboardLayou
 
 void KeyboardLayout::setId(const QString& id)
 {
+    if (id != this->id())
+    {
+        // the stored rows belong to the old ID
+        m_isTrackingChanges = false;
+    }
+
     KeyboardLayoutBase::setId(id);
 
     if (m_associatedDataIndexKeyboardLayout)
@@ -72,6 +81,11 @@ void KeyboardLayout::setId(const QString& id)
 
 void KeyboardLayout::setTitle(const QString& title)
 {
+    if (title != this->title())
+    {
+        m_isModified = true;
+    }
+
     KeyboardLayoutBase::setTitle(title);
 
     if (m_associatedDataIndexKeyboardLayout)
@@ -82,6 +96,11 @@ void KeyboardLayout::setTitle(const QString& title)
 
 void KeyboardLayout::setName(const QString& name)
 {
+    if (name != this->name())
+    {
+        m_isModified = true;
+    }
+
     KeyboardLayoutBase::setName(name);
 
     if (m_associatedDataIndexKeyboardLayout)
@@ -100,6 +119,7 @@ void KeyboardLayout::setWidth(int width)
     if(width != m_width)
     {
         m_width = width;
+        m_isModified = true;
         emit widthChanged();
     }
 }
@@ -114,6 +134,7 @@ void KeyboardLayout::setHeight(int height)
     if(height != m_height)
     {
         m_height = height;
+        m_isModified = true;
         emit heightChanged();
     }
 }
@@ -159,9 +180,46 @@ void KeyboardLayout::copyFrom(KeyboardLayout* source)
 
         addKey(abstractKey);
     }
+    m_isTrackingChanges = false;
     setIsValid(true);
 }
 
+bool KeyboardLayout::isTrackingChanges() const
+{
+    return m_isTrackingChanges;
+}
+
+void KeyboardLayout::startChangeTracking()
+{
+    // from now on the layout is assumed to match its stored version, every
+    // later modification is recorded so only it has to be written back
+
+    m_isTrackingChanges = true;
+    m_isModified = false;
+    m_firstMovedKeyIndex = m_keys.count();
+    m_removedKeyStorageIds.clear();
+
+    foreach (AbstractKey* key, m_keys)
+    {
+        key->setIsModified(false);
+    }
+}
+
+bool KeyboardLayout::isModified() const
+{
+    return m_isModified;
+}
+
+int KeyboardLayout::firstMovedKeyIndex() const
+{
+    return m_firstMovedKeyIndex;
+}
+
+QList<int> KeyboardLayout::removedKeyStorageIds() const
+{
+    return m_removedKeyStorageIds;
+}
+
 AbstractKey* KeyboardLayout::key(int index) const
 {
     Q_ASSERT(index >= 0 && index < m_keys.count());
@@ -175,6 +233,7 @@ int KeyboardLayout::keyIndex(AbstractKey* key) const
 
 void KeyboardLayout::addKey(AbstractKey* key)
 {
+    m_firstMovedKeyIndex = qMin(m_firstMovedKeyIndex, m_keys.count());
     m_keys.append(key);
     key->setParent(this);
     connect(key, SIGNAL(widthChanged()), m_signalMapper, SLOT(map()));
@@ -186,6 +245,7 @@ void KeyboardLayout::addKey(AbstractKey* key)
 
 void KeyboardLayout::insertKey(int index, AbstractKey* key)
 {
+    m_firstMovedKeyIndex = qMin(m_firstMovedKeyIndex, index);
     m_keys.insert(index, key);
     key->setParent(this);
     connect(key, SIGNAL(widthChanged()), m_signalMapper, SLOT(map()));
@@ -199,6 +259,10 @@ void KeyboardLayout::removeKey(int index)
 {
     Q_ASSERT(index >= 0 && index < m_keys.count());
     AbstractKey* key = m_keys.at(index);
+    if (key->storageId() != -1)
+        m_removedKeyStorageIds.append(key->storageId());
+    if (m_firstMovedKeyIndex > index)
+        m_firstMovedKeyIndex--;
     m_keys.removeAt(index);
     emit keyCountChanged();
     updateReferenceKey(0);
@@ -210,6 +274,12 @@ void KeyboardLayout::clearKeys()
     if (m_keys.count() == 0)
         return;
 
+    foreach (AbstractKey* key, m_keys)
+    {
+        if (key->storageId() != -1)
+            m_removedKeyStorageIds.append(key->storageId());
+    }
+    m_firstMovedKeyIndex = 0;
     qDeleteAll(m_keys);
     m_keys.clear();
     emit keyCountChanged();
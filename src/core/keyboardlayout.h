@@ -56,6 +56,11 @@ public:
     Q_INVOKABLE void clearKeys();
     AbstractKey* referenceKey();
     Q_INVOKABLE void copyFrom(KeyboardLayout* source);
+    bool isTrackingChanges() const;
+    void startChangeTracking();
+    bool isModified() const;
+    int firstMovedKeyIndex() const;
+    QList<int> removedKeyStorageIds() const;
 
     QSize size() const;
     void setSize(const QSize& size);
@@ -81,7 +86,10 @@ private:
     QList<AbstractKey*> m_keys;
     AbstractKey* m_referenceKey;
     QSignalMapper* m_signalMapper;
-
+    bool m_isTrackingChanges;
+    bool m_isModified;
+    int m_firstMovedKeyIndex;
+    QList<int> m_removedKeyStorageIds;
 };
 
 #endif // KEYBOARD_H
@@ -20,7 +20,8 @@
 KeyChar::KeyChar(QObject *parent) :
     QObject(parent),
     m_value(QChar(32)),
-    m_position(KeyChar::Hidden)
+    m_position(KeyChar::Hidden),
+    m_isModified(true)
 {
 }
 
@@ -76,6 +77,7 @@ void KeyChar::setValue(const QChar& value)
     if(value != m_value)
     {
         m_value = value;
+        m_isModified = true;
         emit valueChanged();
     }
 }
@@ -90,6 +92,7 @@ void KeyChar::setPosition(KeyChar::Position position)
     if(position != m_position)
     {
         m_position = position;
+        m_isModified = true;
         emit positionChanged();
     }
 }
@@ -104,6 +107,7 @@ void KeyChar::setModifier(const QString& modifier)
     if(modifier != m_modifier)
     {
         m_modifier = modifier;
+        m_isModified = true;
         emit modifierChanged();
     }
 }
@@ -115,3 +119,12 @@ void KeyChar::copyFrom(KeyChar* source)
     setModifier(source->modifier());
 }
 
+bool KeyChar::isModified() const
+{
+    return m_isModified;
+}
+
+void KeyChar::setIsModified(bool isModified)
+{
+    m_isModified = isModified;
+}
@@ -51,6 +51,8 @@ public:
     QString modifier() const;
     void setModifier(const QString& modifier);
     Q_INVOKABLE void copyFrom(KeyChar* source);
+    bool isModified() const;
+    void setIsModified(bool isModified);
 
 signals:
     void valueChanged();
@@ -61,6 +63,7 @@ private:
     QChar m_value;
     Position m_position;
     QString m_modifier;
+    bool m_isModified;
 };
 
 #endif // KEYCHAR_H
@@ -0,0 +1,178 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "keystrokejournal.h"
+
+#include "varint.h"
+
+static const char EncodingVersion = 1;
+static const int FlagBits = 2;
+
+// a header varint of up to ten bytes plus two code points of up to three
+static const int MaxKeystrokeSize = 16;
+
+// room for a few minutes of typing, so appending doesn't have to allocate on
+// every keystroke
+static const int InitialCapacity = 4096;
+
+KeystrokeJournal::KeystrokeJournal() :
+    m_size(0),
+    m_lastTime(0)
+{
+}
+
+bool KeystrokeJournal::isEmpty() const
+{
+    return m_size == 0;
+}
+
+int KeystrokeJournal::size() const
+{
+    return m_size;
+}
+
+void KeystrokeJournal::append(qint64 time, uint expected, uint typed)
+{
+    const bool isCorrect = typed == expected;
+
+    appendHeader(time, isCorrect? 0: IncorrectFlag);
+    appendVarint(m_data, expected);
+
+    if (!isCorrect)
+    {
+        appendVarint(m_data, typed);
+    }
+}
+
+void KeystrokeJournal::appendCorrection(qint64 time)
+{
+    appendHeader(time, CorrectionFlag);
+}
+
+void KeystrokeJournal::reserve(int count)
+{
+    const int required = qMax(m_data.size() + 1 + count * MaxKeystrokeSize, InitialCapacity);
+
+    if (m_data.capacity() < required)
+    {
+        m_data.reserve(qMax(required, 2 * m_data.capacity()));
+    }
+}
+
+void KeystrokeJournal::clear()
+{
+    m_data.resize(0);
+    m_size = 0;
+    m_lastTime = 0;
+}
+
+QByteArray KeystrokeJournal::toByteArray() const
+{
+    return m_data;
+}
+
+void KeystrokeJournal::appendHeader(qint64 time, int flags)
+{
+    if (m_data.isEmpty())
+    {
+        reserve(0);
+        m_data.append(EncodingVersion);
+    }
+
+    // the time of a session never runs backwards, but a caller might
+    // pass a stale value, don't let that wrap around
+    const qint64 delta = qMax(Q_INT64_C(0), time - m_lastTime);
+
+    appendVarint(m_data, (quint64(delta) << FlagBits) | flags);
+    m_lastTime += delta;
+    m_size++;
+}
+
+KeystrokeJournal::Reader::Reader(const QByteArray& data) :
+    m_data(data),
+    m_pos(m_data.constData()),
+    m_end(m_data.constData() + m_data.size()),
+    m_time(0),
+    m_hasError(false)
+{
+    if (m_pos != m_end)
+    {
+        if (*m_pos == EncodingVersion)
+        {
+            m_pos++;
+        }
+        else
+        {
+            m_hasError = true;
+        }
+    }
+}
+
+bool KeystrokeJournal::Reader::readNext(Keystroke& keystroke)
+{
+    if (m_hasError || m_pos == m_end)
+        return false;
+
+    quint64 header;
+
+    if (!readVarint(m_pos, m_end, header))
+    {
+        m_hasError = true;
+        return false;
+    }
+
+    m_time += header >> FlagBits;
+    keystroke.time = m_time;
+    keystroke.flags = header & ((1 << FlagBits) - 1);
+    keystroke.expected = 0;
+    keystroke.typed = 0;
+
+    if (keystroke.flags & CorrectionFlag)
+        return true;
+
+    quint64 expected;
+
+    if (!readVarint(m_pos, m_end, expected) || expected > 0x10ffff)
+    {
+        m_hasError = true;
+        return false;
+    }
+
+    keystroke.expected = expected;
+    keystroke.typed = expected;
+
+    if (keystroke.flags & IncorrectFlag)
+    {
+        quint64 typed;
+
+        if (!readVarint(m_pos, m_end, typed) || typed > 0x10ffff)
+        {
+            m_hasError = true;
+            return false;
+        }
+
+        keystroke.typed = typed;
+    }
+
+    return true;
+}
+
+bool KeystrokeJournal::Reader::hasError() const
+{
+    return m_hasError;
+}
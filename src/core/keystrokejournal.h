@@ -0,0 +1,84 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KEYSTROKEJOURNAL_H
+#define KEYSTROKEJOURNAL_H
+
+#include <QByteArray>
+
+/**
+ * Records every keystroke of a training session.
+ *
+ * Keystrokes are encoded the moment they are appended: a version byte,
+ * then for every keystroke a varint of the milliseconds since the previous
+ * one with the flags in the lowest bits, the expected code point and, for
+ * wrong characters only, the typed code point. Corrections carry no code
+ * points at all. Most keystrokes take three or four bytes.
+ */
+class KeystrokeJournal
+{
+public:
+    enum Flag {
+        IncorrectFlag = 0x1,
+        CorrectionFlag = 0x2
+    };
+
+    struct Keystroke
+    {
+        qint64 time;
+        uint expected;
+        uint typed;
+        int flags;
+    };
+
+    /**
+     * Decodes a journal one keystroke at a time, without unpacking all of
+     * it first.
+     */
+    class Reader
+    {
+    public:
+        explicit Reader(const QByteArray& data);
+        bool readNext(Keystroke& keystroke);
+        bool hasError() const;
+
+    private:
+        QByteArray m_data;
+        const char* m_pos;
+        const char* m_end;
+        qint64 m_time;
+        bool m_hasError;
+    };
+
+    KeystrokeJournal();
+    bool isEmpty() const;
+    int size() const;
+    void append(qint64 time, uint expected, uint typed);
+    void appendCorrection(qint64 time);
+    void reserve(int count);
+    void clear();
+    QByteArray toByteArray() const;
+
+private:
+    void appendHeader(qint64 time, int flags);
+    QByteArray m_data;
+    int m_size;
+    qint64 m_lastTime;
+};
+
+#endif // KEYSTROKEJOURNAL_H
@@ -17,8 +17,12 @@
 
 #include "lesson.h"
 
+#include "lessontextprovider.h"
+
 Lesson::Lesson(QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    m_isTextLoaded(true),
+    m_isModified(true)
 {
 }
 
@@ -31,7 +35,10 @@ void Lesson::setId(const QString& id)
 {
     if(id != m_id)
     {
+        // providers may look texts up by the ID they were handed out for
+        detachText();
         m_id = id;
+        m_isModified = true;
         emit idChanged();
     }
 }
@@ -46,6 +53,7 @@ void Lesson::setTitle(const QString& title)
     if(title != m_title)
     {
         m_title = title;
+        m_isModified = true;
         emit titleChanged();
     }
 }
@@ -60,6 +68,7 @@ void Lesson::setNewCharacters(const QString& newCharacters)
     if (newCharacters != m_newCharacters)
     {
         m_newCharacters = newCharacters;
+        m_isModified = true;
         emit newCharactersChanged();
     }
 }
@@ -80,18 +89,67 @@ void Lesson::setCharacters(const QString& characters)
 
 QString Lesson::text()
 {
+    if (!m_isTextLoaded)
+    {
+        m_text = m_textProvider->lessonText(m_textKey);
+        m_isTextLoaded = true;
+    }
+
     return m_text;
 }
 
 void Lesson::setText(const QString& text)
 {
-    if (text != m_text)
+    if (text != this->text())
     {
         m_text = text;
+        m_textProvider.clear();
+        m_isModified = true;
         emit textChanged();
     }
 }
 
+void Lesson::setTextProvider(const QSharedPointer<LessonTextProvider>& provider, const QString& key)
+{
+    m_textProvider = provider;
+    m_textKey = key;
+    m_text.clear();
+    m_isTextLoaded = provider.isNull();
+    emit textChanged();
+}
+
+bool Lesson::isTextLoaded() const
+{
+    return m_isTextLoaded;
+}
+
+bool Lesson::evictText()
+{
+    // only texts which can be fetched again are dropped
+    if (!m_textProvider || !m_isTextLoaded)
+        return false;
+
+    m_text.clear();
+    m_isTextLoaded = false;
+    return true;
+}
+
+void Lesson::detachText()
+{
+    text();
+    m_textProvider.clear();
+}
+
+bool Lesson::isModified() const
+{
+    return m_isModified;
+}
+
+void Lesson::setIsModified(bool isModified)
+{
+    m_isModified = isModified;
+}
+
 void Lesson::copyFrom(Lesson* source)
 {
     setId(source->id());
@@ -21,6 +21,9 @@
 #include <QObject>
 #include <QString>
 #include <QList>
+#include <QSharedPointer>
+
+class LessonTextProvider;
 
 class Lesson : public QObject
 {
@@ -43,6 +46,11 @@ public:
     void setCharacters(const QString& characters);
     QString text();
     void setText(const QString& text);
+    void setTextProvider(const QSharedPointer<LessonTextProvider>& provider, const QString& key);
+    bool isTextLoaded() const;
+    bool evictText();
+    bool isModified() const;
+    void setIsModified(bool isModified);
     Q_INVOKABLE void copyFrom(Lesson* source);
 
 signals:
@@ -54,11 +62,16 @@ signals:
 
 private:
     Q_DISABLE_COPY(Lesson)
+    void detachText();
     QString m_id;
     QString m_title;
     QString m_newCharacters;
     QString m_characters;
     QString m_text;
+    QSharedPointer<LessonTextProvider> m_textProvider;
+    QString m_textKey;
+    bool m_isTextLoaded;
+    bool m_isModified;
 };
 
 #endif // LESSON_H
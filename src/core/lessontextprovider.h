@@ -0,0 +1,39 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LESSONTEXTPROVIDER_H
+#define LESSONTEXTPROVIDER_H
+
+#include <QString>
+
+/**
+ * Fetches lesson texts on demand.
+ *
+ * Data access classes may hand a provider to the lessons they load instead
+ * of their texts, together with a key of the provider's choosing. A lesson
+ * asks for its text the first time it is needed and can drop it again
+ * later on, see Lesson::evictText().
+ */
+class LessonTextProvider
+{
+public:
+    virtual ~LessonTextProvider() {}
+    virtual QString lessonText(const QString& key) = 0;
+};
+
+#endif // LESSONTEXTPROVIDER_H
@@ -24,11 +24,13 @@
 
 #include <KLocalizedString>
 
+#include "application.h"
 #include "core/profile.h"
 #include "core/course.h"
 #include "core/lesson.h"
 #include "core/keyboardlayout.h"
 #include "core/trainingstats.h"
+#include "core/trainingstatswriter.h"
 
 ProfileDataAccess::ProfileDataAccess(QObject* parent) :
     DbAccess(parent)
@@ -103,7 +105,7 @@ void ProfileDataAccess::addProfile(Profile* profile)
 
     QSqlQuery addQuery(db);
 
-    if (!addQuery.prepare("INSERT INTO profiles (name, skill_level, last_used_course_id) VALUES (?, ?, ?)"))
+    if (!prepareQuery(addQuery, "INSERT INTO profiles (name, skill_level, last_used_course_id) VALUES (?, ?, ?)"))
     {
         qWarning() <<  addQuery.lastError().text();
         raiseError(addQuery.lastError());
@@ -165,7 +167,7 @@ void ProfileDataAccess::updateProfile(int index)
 
     QSqlQuery updateQuery(db);
 
-    if (!updateQuery.prepare("UPDATE profiles SET name = ?, skill_level = ?, last_used_course_id = ? WHERE id = ?"))
+    if (!prepareQuery(updateQuery, "UPDATE profiles SET name = ?, skill_level = ?, last_used_course_id = ? WHERE id = ?"))
     {
         qWarning() <<  updateQuery.lastError().text();
         raiseError(updateQuery.lastError());
@@ -213,7 +215,7 @@ void ProfileDataAccess::removeProfile(int index)
 
     QSqlQuery removeQuery(db);
 
-    if (!removeQuery.prepare("DELETE FROM profiles WHERE id = ?"))
+    if (!prepareQuery(removeQuery, "DELETE FROM profiles WHERE id = ?"))
     {
         qWarning() <<  removeQuery.lastError().text();
         raiseError(removeQuery.lastError());
@@ -232,6 +234,66 @@ void ProfileDataAccess::removeProfile(int index)
         return;
     }
 
+    QSqlQuery removeSummaryQuery(db);
+
+    if (!prepareQuery(removeSummaryQuery, "DELETE FROM profile_summary WHERE profile_id = ?"))
+    {
+        qWarning() <<  removeSummaryQuery.lastError().text();
+        raiseError(removeSummaryQuery.lastError());
+        db.rollback();
+        return;
+    }
+
+    removeSummaryQuery.bindValue(0, profile->id());
+
+    if (!removeSummaryQuery.exec())
+    {
+        qWarning() <<  removeSummaryQuery.lastError().text();
+        raiseError(removeSummaryQuery.lastError());
+        db.rollback();
+        return;
+    }
+
+    QSqlQuery removeKeystrokesQuery(db);
+
+    if (!prepareQuery(removeKeystrokesQuery, "DELETE FROM training_stats_keystrokes WHERE stats_id IN (SELECT id FROM training_stats WHERE profile_id = ?)"))
+    {
+        qWarning() <<  removeKeystrokesQuery.lastError().text();
+        raiseError(removeKeystrokesQuery.lastError());
+        db.rollback();
+        return;
+    }
+
+    removeKeystrokesQuery.bindValue(0, profile->id());
+
+    if (!removeKeystrokesQuery.exec())
+    {
+        qWarning() <<  removeKeystrokesQuery.lastError().text();
+        raiseError(removeKeystrokesQuery.lastError());
+        db.rollback();
+        return;
+    }
+
+    QSqlQuery removeRollupsQuery(db);
+
+    if (!prepareQuery(removeRollupsQuery, "DELETE FROM training_stats_rollups WHERE profile_id = ?"))
+    {
+        qWarning() <<  removeRollupsQuery.lastError().text();
+        raiseError(removeRollupsQuery.lastError());
+        db.rollback();
+        return;
+    }
+
+    removeRollupsQuery.bindValue(0, profile->id());
+
+    if (!removeRollupsQuery.exec())
+    {
+        qWarning() <<  removeRollupsQuery.lastError().text();
+        raiseError(removeRollupsQuery.lastError());
+        db.rollback();
+        return;
+    }
+
     if (!db.commit())
     {
         qWarning() <<  db.lastError().text();
@@ -260,7 +322,7 @@ void ProfileDataAccess::loadReferenceTrainingStats(TrainingStats* stats, Profile
     stats->setCharactersTyped(0);
     stats->setElapsedTime(QTime());
     stats->setErrorCount(0);
-    stats->setErrorMap(QMap<QString, int>());
+    stats->setErrorHistogram(ErrorHistogram());
     stats->setIsValid(false);
 
     QSqlDatabase db = database();
@@ -270,7 +332,7 @@ void ProfileDataAccess::loadReferenceTrainingStats(TrainingStats* stats, Profile
 
     QSqlQuery selectQuery;
 
-    if (!selectQuery.prepare("SELECT id, characters_typed, error_count, elapsed_time FROM training_stats WHERE profile_id = ? AND course_id = ? AND lesson_id = ? ORDER BY date DESC LIMIT 1"))
+    if (!prepareQuery(selectQuery, "SELECT characters_typed, error_count, elapsed_time, errors FROM training_stats WHERE profile_id = ? AND course_id = ? AND lesson_id = ? ORDER BY date DESC LIMIT 1"))
     {
         qWarning() <<  selectQuery.lastError().text();
         raiseError(selectQuery.lastError());
@@ -291,123 +353,40 @@ void ProfileDataAccess::loadReferenceTrainingStats(TrainingStats* stats, Profile
     if (!selectQuery.next())
         return;
 
-    const int statsId = selectQuery.value(0).toInt();
-    stats->setCharactersTyped(selectQuery.value(1).toUInt());
-    stats->setErrorCount(selectQuery.value(2).toUInt());
-    stats->setElapsedTime(selectQuery.value(3).toInt());
+    stats->setCharactersTyped(selectQuery.value(0).toUInt());
+    stats->setErrorCount(selectQuery.value(1).toUInt());
+    stats->setElapsedTime(selectQuery.value(2).toInt());
 
-    QSqlQuery errorSelectQuery;
+    ErrorHistogram errorHistogram;
 
-    errorSelectQuery.prepare("SELECT character, count FROM training_stats_errors WHERE stats_id = ?");
-
-    errorSelectQuery.bindValue(0, statsId);
-
-    if (!errorSelectQuery.exec())
+    if (!errorHistogram.fromByteArray(selectQuery.value(3).toByteArray()))
     {
-        qWarning() <<  errorSelectQuery.lastError().text();
-        raiseError(errorSelectQuery.lastError());
-        return;
+        qWarning() << "invalid error histogram for lesson" << lessonId;
     }
 
-    QMap<QString, int> errorMap;
-
-    while (errorSelectQuery.next())
-    {
-        const QString character = errorSelectQuery.value(0).toString();
-        const int errorCount = errorSelectQuery.value(1).toInt();
-        errorMap.insert(character, errorCount);
-    }
+    selectQuery.finish();
 
-    stats->setErrorMap(errorMap);
+    stats->setErrorHistogram(errorHistogram);
     stats->setIsValid(true);
 }
 
 void ProfileDataAccess::saveTrainingStats(TrainingStats* stats, Profile* profile, const QString& courseId, const QString& lessonId)
 {
-    QSqlDatabase db = database();
-
-    if (!db.isOpen())
-        return;
-
-    if (!db.transaction())
-    {
-        qWarning() <<  db.lastError().text();
-        raiseError(db.lastError());
-        return;
-    }
-    QSqlQuery addQuery(db);
-
-    if (!addQuery.prepare("INSERT INTO training_stats (profile_id, course_id, lesson_id, date, characters_typed, error_count, elapsed_time) VALUES (?, ?, ?, ?, ?, ?, ?)"))
-    {
-        qWarning() <<  addQuery.lastError().text();
-        raiseError(addQuery.lastError());
-        db.rollback();
-        return;
-    }
-    addQuery.bindValue(0, profile->id());
-    addQuery.bindValue(1, courseId);
-    addQuery.bindValue(2, lessonId);
-    addQuery.bindValue(3, QDateTime::currentMSecsSinceEpoch());
-    addQuery.bindValue(4, stats->charactesTyped());
-    addQuery.bindValue(5, stats->errorCount());
-    const int rawElapsedTime = QTime(0, 0).msecsTo(stats->elapsedTime());
-    addQuery.bindValue(6, rawElapsedTime);
-
-    if (!addQuery.exec())
-    {
-        qWarning() <<  addQuery.lastError().text();
-        raiseError(addQuery.lastError());
-        db.rollback();
-        return;
-    }
-
-    QSqlQuery idQuery = db.exec("SELECT last_insert_rowid()");
-
-    if (db.lastError().isValid())
-    {
-        qWarning() << db.lastError().text();
-        raiseError(db.lastError());
-        db.rollback();
-        return;
-    }
-
-    idQuery.next();
-    int statsId = idQuery.value(0).toInt();
-
-    QSqlQuery addErrorsQuery(db);
-
-    if (!addErrorsQuery.prepare("INSERT INTO training_stats_errors (stats_id, character, count) VALUES (?, ?, ?)"))
-    {
-        qWarning() <<  addErrorsQuery.lastError().text();
-        raiseError(addErrorsQuery.lastError());
-        db.rollback();
-        return;
-    }
-
-    QMapIterator<QString, int> errorIterator(stats->errorMap());
-    while(errorIterator.hasNext())
-    {
-        errorIterator.next();
-        addErrorsQuery.bindValue(0, statsId);
-        addErrorsQuery.bindValue(1, errorIterator.key());
-        addErrorsQuery.bindValue(2, errorIterator.value());
-
-        if (!addErrorsQuery.exec())
-        {
-            qWarning() <<  addErrorsQuery.lastError().text();
-            raiseError(addErrorsQuery.lastError());
-            db.rollback();
-            return;
-        }
-    }
-
-    if(!db.commit())
-    {
-        qWarning() <<  db.lastError().text();
-        raiseError(db.lastError());
-        db.rollback();
-        return;
-    }
+    // the record is written by the writer thread, so a slow disk doesn't
+    // block the GUI
+
+    TrainingStatsRecord record;
+    record.profileId = profile->id();
+    record.courseId = courseId;
+    record.lessonId = lessonId;
+    record.date = QDateTime::currentMSecsSinceEpoch();
+    record.charactersTyped = stats->charactesTyped();
+    record.errorCount = stats->errorCount();
+    record.elapsedTime = QTime(0, 0).msecsTo(stats->elapsedTime());
+    record.errorHistogram = stats->errorHistogram();
+    record.keystrokes = stats->keystrokeJournal().toByteArray();
+
+    Application::trainingStatsWriter()->enqueue(record);
 }
 
 QString ProfileDataAccess::courseProgress(Profile* profile, const QString& courseId, CourseProgressType type)
@@ -425,7 +404,7 @@ QString ProfileDataAccess::courseProgress(Profile* profile, const QString& cours
 
     QSqlQuery selectQuery;
 
-    selectQuery.prepare("SELECT lesson_id FROM course_progress WHERE id = ?");
+    prepareQuery(selectQuery, "SELECT lesson_id FROM course_progress WHERE id = ?");
 
     selectQuery.bindValue(0, id);
 
@@ -437,7 +416,9 @@ QString ProfileDataAccess::courseProgress(Profile* profile, const QString& cours
     }
 
     selectQuery.next();
-    return selectQuery.value(0).toString();
+    const QString lessonId = selectQuery.value(0).toString();
+    selectQuery.finish();
+    return lessonId;
 }
 
 void ProfileDataAccess::saveCourseProgress(const QString& lessonId, Profile* profile, const QString& courseId, CourseProgressType type)
@@ -464,7 +445,7 @@ void ProfileDataAccess::saveCourseProgress(const QString& lessonId, Profile* pro
     {
         QSqlQuery insertQuery;
 
-        insertQuery.prepare("INSERT INTO course_progress (profile_id, course_id, type, lesson_id) VALUES (?, ?, ?, ?)");
+        prepareQuery(insertQuery, "INSERT INTO course_progress (profile_id, course_id, type, lesson_id) VALUES (?, ?, ?, ?)");
 
         insertQuery.bindValue(0, profile->id());
         insertQuery.bindValue(1, courseId);
@@ -483,7 +464,7 @@ void ProfileDataAccess::saveCourseProgress(const QString& lessonId, Profile* pro
     {
         QSqlQuery updateQuery;
 
-        updateQuery.prepare("UPDATE course_progress SET lesson_id = ? WHERE id = ?");
+        prepareQuery(updateQuery, "UPDATE course_progress SET lesson_id = ? WHERE id = ?");
 
         updateQuery.bindValue(0, lessonId);
         updateQuery.bindValue(1, id);
@@ -513,11 +494,11 @@ int ProfileDataAccess::lessonsTrained(Profile* profile)
     if (!profile)
         return 0;
 
-    QString sql = "SELECT COUNT(*) FROM training_stats WHERE profile_id = ?";
+    QString sql = "SELECT lessons_trained FROM profile_summary WHERE profile_id = ?";
 
     QSqlQuery query(db);
 
-    query.prepare(sql);
+    prepareQuery(query, sql);
     query.bindValue(0, profile->id());
 
     if (!query.exec())
@@ -527,8 +508,12 @@ int ProfileDataAccess::lessonsTrained(Profile* profile)
         return 0;
     }
 
-    query.next();
-    return query.value(0).toInt();
+    if (!query.next())
+        return 0;
+
+    const int count = query.value(0).toInt();
+    query.finish();
+    return count;
 }
 
 quint64 ProfileDataAccess::totalTrainingTime(Profile* profile)
@@ -538,11 +523,11 @@ quint64 ProfileDataAccess::totalTrainingTime(Profile* profile)
     if (!profile)
         return 0;
 
-    QString sql = "SELECT SUM(elapsed_time) FROM training_stats WHERE profile_id = ?";
+    QString sql = "SELECT total_training_time FROM profile_summary WHERE profile_id = ?";
 
     QSqlQuery query(db);
 
-    query.prepare(sql);
+    prepareQuery(query, sql);
     query.bindValue(0, profile->id());
 
     if (!query.exec())
@@ -552,8 +537,12 @@ quint64 ProfileDataAccess::totalTrainingTime(Profile* profile)
         return 0;
     }
 
-    query.next();
-    return query.value(0).value<quint64>();
+    if (!query.next())
+        return 0;
+
+    const quint64 time = query.value(0).value<quint64>();
+    query.finish();
+    return time;
 }
 
 QDateTime ProfileDataAccess::lastTrainingSession(Profile* profile)
@@ -563,11 +552,11 @@ QDateTime ProfileDataAccess::lastTrainingSession(Profile* profile)
     if (!profile)
         return QDateTime();
 
-    QString sql = "SELECT date FROM training_stats WHERE profile_id = ? ORDER BY date DESC LIMIT 1";
+    QString sql = "SELECT last_training_session FROM profile_summary WHERE profile_id = ?";
 
     QSqlQuery query(db);
 
-    query.prepare(sql);
+    prepareQuery(query, sql);
     query.bindValue(0, profile->id());
 
     if (!query.exec())
@@ -580,7 +569,9 @@ QDateTime ProfileDataAccess::lastTrainingSession(Profile* profile)
     if (!query.next())
         return QDateTime();
 
-    return QDateTime::fromMSecsSinceEpoch(query.value(0).value<quint64>());
+    const quint64 date = query.value(0).value<quint64>();
+    query.finish();
+    return QDateTime::fromMSecsSinceEpoch(date);
 }
 
 bool ProfileDataAccess::loadCustomLessons(Profile* profile, const QString& keyboardLayoutNameFilter, Course* target)
@@ -604,7 +595,7 @@ bool ProfileDataAccess::loadCustomLessons(Profile* profile, const QString& keybo
 
     QSqlQuery query(db);
 
-    query.prepare(sql);
+    prepareQuery(query, sql);
 
     query.bindValue(0, profile->id());
 
@@ -676,7 +667,7 @@ bool ProfileDataAccess::storeCustomLesson(Lesson* lesson, Profile* profile, cons
 
     QSqlQuery idQuery(db);
 
-    idQuery.prepare("SELECT count(*) FROM custom_lessons WHERE id = ?");
+    prepareQuery(idQuery, "SELECT count(*) FROM custom_lessons WHERE id = ?");
     idQuery.bindValue(0, lesson->id());
     idQuery.exec();
 
@@ -690,12 +681,13 @@ bool ProfileDataAccess::storeCustomLesson(Lesson* lesson, Profile* profile, cons
 
     idQuery.next();
     const bool lessonAlreadyExists = idQuery.value(0).toInt() == 1;
+    idQuery.finish();
 
     if (lessonAlreadyExists)
     {
         QSqlQuery updateQuery(db);
 
-        updateQuery.prepare("UPDATE custom_lessons SET profile_id = ?, title = ?, text = ?, keyboard_layout_name = ? WHERE id = ?");
+        prepareQuery(updateQuery, "UPDATE custom_lessons SET profile_id = ?, title = ?, text = ?, keyboard_layout_name = ? WHERE id = ?");
 
         if (updateQuery.lastError().isValid())
         {
@@ -725,7 +717,7 @@ bool ProfileDataAccess::storeCustomLesson(Lesson* lesson, Profile* profile, cons
     {
         QSqlQuery insertQuery(db);
 
-        insertQuery.prepare("INSERT INTO custom_lessons (id, profile_id, title, text, keyboard_layout_name) VALUES (?, ?, ?, ?, ?)");
+        prepareQuery(insertQuery, "INSERT INTO custom_lessons (id, profile_id, title, text, keyboard_layout_name) VALUES (?, ?, ?, ?, ?)");
 
         if (insertQuery.lastError().isValid())
         {
@@ -779,7 +771,7 @@ bool ProfileDataAccess::deleteCustomLesson(const QString& id)
 
     QSqlQuery deleteQuery(db);
 
-    deleteQuery.prepare("DELETE FROM custom_lessons WHERE id = ?");
+    prepareQuery(deleteQuery, "DELETE FROM custom_lessons WHERE id = ?");
     deleteQuery.bindValue(0, id);
     deleteQuery.exec();
 
@@ -812,32 +804,45 @@ QSqlQuery ProfileDataAccess::learningProgressQuery(Profile* profile, Course* cou
     if (!db.isOpen())
         return QSqlQuery();
 
-    QString sql = "SELECT date, characters_typed, error_count, elapsed_time, lesson_id FROM training_stats WHERE profile_id = ?";
+    QString filter = "profile_id = ?";
 
     if (courseFilter)
     {
-        sql += " AND course_id = ?";
+        filter += " AND course_id = ?";
     }
 
     if (lessonFilter)
     {
-        sql += " AND lesson_id = ?";
+        filter += " AND lesson_id = ?";
     }
 
+    // old sessions have been merged into daily or weekly totals, each of
+    // them is a single point in the progress chart
+
+    const QString sql = QString("SELECT date, characters_typed, error_count, elapsed_time, lesson_id FROM training_stats_rollups WHERE %1 "
+                                "UNION ALL "
+                                "SELECT date, characters_typed, error_count, elapsed_time, lesson_id FROM training_stats WHERE %1 "
+                                "ORDER BY date").arg(filter);
+
     QSqlQuery query(db);
 
     query.prepare(sql);
 
-    query.bindValue(0, profile->id());
+    const int filterValueCount = 1 + (courseFilter? 1: 0) + (lessonFilter? 1: 0);
 
-    if (courseFilter)
+    for (int offset = 0; offset < 2 * filterValueCount; offset += filterValueCount)
     {
-        query.bindValue(1, courseFilter->id());
-    }
+        query.bindValue(offset, profile->id());
 
-    if (lessonFilter)
-    {
-        query.bindValue(courseFilter? 2: 1, lessonFilter->id());
+        if (courseFilter)
+        {
+            query.bindValue(offset + 1, courseFilter->id());
+        }
+
+        if (lessonFilter)
+        {
+            query.bindValue(offset + (courseFilter? 2: 1), lessonFilter->id());
+        }
     }
 
     if (!query.exec())
@@ -861,7 +866,7 @@ int ProfileDataAccess::findCourseProgressId(Profile* profile, const QString& cou
 
     QSqlQuery findQuery;
 
-    findQuery.prepare("SELECT id FROM course_progress WHERE profile_id = ? AND course_id = ? AND type = ? LIMIT 1");
+    prepareQuery(findQuery, "SELECT id FROM course_progress WHERE profile_id = ? AND course_id = ? AND type = ? LIMIT 1");
 
     findQuery.bindValue(0, profile->id());
     findQuery.bindValue(1, courseId);
@@ -881,5 +886,7 @@ int ProfileDataAccess::findCourseProgressId(Profile* profile, const QString& cou
         return -1;
     }
 
-    return findQuery.value(0).toInt();
+    const int id = findQuery.value(0).toInt();
+    findQuery.finish();
+    return id;
 }
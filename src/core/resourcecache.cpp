@@ -0,0 +1,623 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "resourcecache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+
+#include <string.h>
+
+#include "course.h"
+#include "lesson.h"
+#include "keyboardlayout.h"
+#include "key.h"
+#include "keychar.h"
+#include "specialkey.h"
+
+static const quint32 cacheMagic = 0x4352544b; // "KTRC" in little endian
+static const quint16 cacheVersion = 1;
+static const quint32 nullString = 0xffffffff;
+static const int sourceHashSize = 20;
+
+struct CacheHeader
+{
+    quint32 magic;
+    quint16 version;
+    quint16 type;
+    quint32 size;
+    quint32 checksum;
+    qint64 sourceModified;
+    qint64 sourceSize;
+    char sourceHash[sourceHashSize];
+    quint32 recordCount;
+    quint32 keyCharCount;
+    quint32 stringCount;
+};
+
+struct ResourceRecord
+{
+    quint32 id;
+    quint32 title;
+    quint32 description;
+    quint32 name;
+    quint32 width;
+    quint32 height;
+};
+
+struct LessonRecord
+{
+    quint32 id;
+    quint32 title;
+    quint32 newCharacters;
+    quint32 text;
+};
+
+struct KeyRecord
+{
+    // 0 for ordinary keys, SpecialKey::Type + 1 for special keys
+    quint32 type;
+    qint32 left;
+    qint32 top;
+    qint32 width;
+    qint32 height;
+    quint32 fingerIndex;
+    quint32 hasHapticMarker;
+    quint32 modifierId;
+    quint32 label;
+    quint32 firstKeyChar;
+    quint32 keyCharCount;
+};
+
+struct KeyCharRecord
+{
+    quint32 position;
+    quint32 modifier;
+    quint32 value;
+};
+
+struct StringEntry
+{
+    quint32 offset;
+    quint32 length;
+};
+
+// FNV-1a, only meant to catch truncated or otherwise damaged files
+static quint32 checksum(const uchar* data, qint64 size)
+{
+    quint32 hash = 2166136261u;
+
+    for (qint64 i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+template<typename T>
+static void appendRecord(QByteArray& data, const T& record)
+{
+    data.append(reinterpret_cast<const char*>(&record), sizeof(T));
+}
+
+template<typename T>
+static T recordAt(const uchar* records, quint32 index)
+{
+    T record;
+    memcpy(&record, records + index * sizeof(T), sizeof(T));
+    return record;
+}
+
+namespace
+{
+    class StringTableBuilder
+    {
+    public:
+        quint32 add(const QString& string)
+        {
+            if (string.isNull())
+                return nullString;
+
+            QHash<QString, quint32>::const_iterator it = m_indexes.constFind(string);
+
+            if (it != m_indexes.constEnd())
+                return it.value();
+
+            StringEntry entry;
+            entry.offset = m_data.length();
+            entry.length = string.length();
+            m_entries.append(entry);
+            m_data.append(string);
+            const quint32 index = m_entries.count() - 1;
+            m_indexes.insert(string, index);
+            return index;
+        }
+
+        quint32 count() const
+        {
+            return m_entries.count();
+        }
+
+        void appendTo(QByteArray& data) const
+        {
+            foreach (const StringEntry& entry, m_entries)
+            {
+                appendRecord(data, entry);
+            }
+
+            data.append(reinterpret_cast<const char*>(m_data.constData()), m_data.length() * sizeof(QChar));
+        }
+
+    private:
+        QVector<StringEntry> m_entries;
+        QString m_data;
+        QHash<QString, quint32> m_indexes;
+    };
+}
+
+ResourceCache::ResourceCache(const QString& sourcePath, Type type) :
+    m_sourcePath(sourcePath),
+    m_type(type),
+    m_data(0),
+    m_size(0),
+    m_records(0),
+    m_keyChars(0),
+    m_strings(0),
+    m_stringData(0),
+    m_stringDataLength(0),
+    m_isValid(false),
+    m_hasError(false)
+{
+    m_file.setFileName(cachePath(sourcePath, type));
+    m_isValid = open();
+}
+
+ResourceCache::~ResourceCache()
+{
+    if (m_data)
+    {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+}
+
+bool ResourceCache::isValid() const
+{
+    return m_isValid;
+}
+
+bool ResourceCache::isUpToDate() const
+{
+    if (!m_isValid)
+        return false;
+
+    const CacheHeader header = recordAt<CacheHeader>(m_data, 0);
+    const QFileInfo sourceInfo(m_sourcePath);
+
+    return sourceInfo.lastModified().toMSecsSinceEpoch() == header.sourceModified &&
+        sourceInfo.size() == header.sourceSize;
+}
+
+bool ResourceCache::matches(const QByteArray& sourceHash) const
+{
+    if (!m_isValid || sourceHash.size() != sourceHashSize)
+        return false;
+
+    const CacheHeader header = recordAt<CacheHeader>(m_data, 0);
+
+    return memcmp(header.sourceHash, sourceHash.constData(), sourceHashSize) == 0;
+}
+
+bool ResourceCache::readCourse(Course* target)
+{
+    if (!m_isValid || m_type != CourseCache)
+        return false;
+
+    const CacheHeader header = recordAt<CacheHeader>(m_data, 0);
+    const ResourceRecord resource = recordAt<ResourceRecord>(m_data + sizeof(CacheHeader), 0);
+    const QSharedPointer<ResourceCache> textProvider = sharedFromThis();
+    QList<Lesson*> lessons;
+
+    for (quint32 i = 0; i < header.recordCount && !m_hasError; i++)
+    {
+        const LessonRecord record = recordAt<LessonRecord>(m_records, i);
+        Lesson* lesson = new Lesson(target);
+        lesson->setId(string(record.id));
+        lesson->setTitle(string(record.title));
+        lesson->setNewCharacters(string(record.newCharacters));
+        if (!textProvider)
+        {
+            lesson->setText(string(record.text));
+        }
+        else if (hasString(record.text))
+        {
+            lesson->setTextProvider(textProvider, QString::number(record.text));
+        }
+        else
+        {
+            m_hasError = true;
+        }
+        lessons.append(lesson);
+    }
+
+    const QString id = string(resource.id);
+    const QString title = string(resource.title);
+    const QString description = string(resource.description);
+    const QString keyboardLayoutName = string(resource.name);
+
+    if (m_hasError)
+    {
+        qWarning() << "damaged cache:" << m_file.fileName();
+        qDeleteAll(lessons);
+        return false;
+    }
+
+    target->setId(id);
+    target->setTitle(title);
+    target->setDescription(description);
+    target->setKeyboardLayoutName(keyboardLayoutName);
+    target->clearLessons();
+    foreach (Lesson* lesson, lessons)
+    {
+        target->addLesson(lesson);
+    }
+
+    return true;
+}
+
+bool ResourceCache::readKeyboardLayout(KeyboardLayout* target)
+{
+    if (!m_isValid || m_type != KeyboardLayoutCache)
+        return false;
+
+    const CacheHeader header = recordAt<CacheHeader>(m_data, 0);
+    const ResourceRecord resource = recordAt<ResourceRecord>(m_data + sizeof(CacheHeader), 0);
+    QList<AbstractKey*> keys;
+
+    for (quint32 i = 0; i < header.recordCount && !m_hasError; i++)
+    {
+        const KeyRecord record = recordAt<KeyRecord>(m_records, i);
+        AbstractKey* abstractKey;
+
+        if (record.type == 0)
+        {
+            Key* key = new Key(target);
+            key->setFingerIndex(record.fingerIndex);
+            key->setHasHapticMarker(record.hasHapticMarker);
+
+            if (record.fingerIndex > 7 ||
+                record.firstKeyChar > header.keyCharCount ||
+                record.keyCharCount > header.keyCharCount - record.firstKeyChar)
+            {
+                m_hasError = true;
+            }
+
+            for (quint32 j = 0; j < record.keyCharCount && !m_hasError; j++)
+            {
+                const KeyCharRecord charRecord = recordAt<KeyCharRecord>(m_keyChars, record.firstKeyChar + j);
+
+                if (charRecord.position > quint32(KeyChar::BottomRight) || charRecord.value > 0xffff)
+                {
+                    m_hasError = true;
+                    break;
+                }
+
+                KeyChar* keyChar = new KeyChar(key);
+                keyChar->setPosition(static_cast<KeyChar::Position>(charRecord.position));
+                keyChar->setModifier(string(charRecord.modifier));
+                keyChar->setValue(QChar(charRecord.value));
+                key->addKeyChar(keyChar);
+            }
+
+            abstractKey = key;
+        }
+        else
+        {
+            SpecialKey* specialKey = new SpecialKey(target);
+
+            if (record.type - 1 > quint32(SpecialKey::Other))
+            {
+                m_hasError = true;
+            }
+
+            specialKey->setType(static_cast<SpecialKey::Type>(record.type - 1));
+            specialKey->setModifierId(string(record.modifierId));
+            specialKey->setLabel(string(record.label));
+            abstractKey = specialKey;
+        }
+
+        abstractKey->setLeft(record.left);
+        abstractKey->setTop(record.top);
+        abstractKey->setWidth(record.width);
+        abstractKey->setHeight(record.height);
+        keys.append(abstractKey);
+    }
+
+    const QString id = string(resource.id);
+    const QString title = string(resource.title);
+    const QString name = string(resource.name);
+
+    if (m_hasError)
+    {
+        qWarning() << "damaged cache:" << m_file.fileName();
+        qDeleteAll(keys);
+        return false;
+    }
+
+    target->clearKeys();
+    target->setId(id);
+    target->setTitle(title);
+    target->setName(name);
+    target->setWidth(resource.width);
+    target->setHeight(resource.height);
+    foreach (AbstractKey* key, keys)
+    {
+        target->addKey(key);
+    }
+
+    return true;
+}
+
+bool ResourceCache::write(const QString& sourcePath, const QByteArray& sourceHash, Course* source)
+{
+    StringTableBuilder strings;
+    QByteArray records;
+
+    ResourceRecord resource;
+    resource.id = strings.add(source->id());
+    resource.title = strings.add(source->title());
+    resource.description = strings.add(source->description());
+    resource.name = strings.add(source->keyboardLayoutName());
+    resource.width = 0;
+    resource.height = 0;
+    appendRecord(records, resource);
+
+    for (int i = 0; i < source->lessonCount(); i++)
+    {
+        Lesson* const lesson = source->lesson(i);
+        LessonRecord record;
+        record.id = strings.add(lesson->id());
+        record.title = strings.add(lesson->title());
+        record.newCharacters = strings.add(lesson->newCharacters());
+        record.text = strings.add(lesson->text());
+        appendRecord(records, record);
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.sourceHash, sourceHash.constData(), qMin(sourceHash.size(), sourceHashSize));
+    header.type = CourseCache;
+    header.recordCount = source->lessonCount();
+    header.keyCharCount = 0;
+    header.stringCount = strings.count();
+
+    QByteArray data;
+    appendRecord(data, header);
+    data.append(records);
+    strings.appendTo(data);
+
+    return write(sourcePath, CourseCache, data);
+}
+
+bool ResourceCache::write(const QString& sourcePath, const QByteArray& sourceHash, KeyboardLayout* source)
+{
+    StringTableBuilder strings;
+    QByteArray records;
+    QByteArray keyChars;
+    quint32 keyCharCount = 0;
+
+    ResourceRecord resource;
+    resource.id = strings.add(source->id());
+    resource.title = strings.add(source->title());
+    resource.description = nullString;
+    resource.name = strings.add(source->name());
+    resource.width = source->width();
+    resource.height = source->height();
+    appendRecord(records, resource);
+
+    for (int i = 0; i < source->keyCount(); i++)
+    {
+        AbstractKey* const abstractKey = source->key(i);
+        KeyRecord record;
+        memset(&record, 0, sizeof(KeyRecord));
+        record.left = abstractKey->left();
+        record.top = abstractKey->top();
+        record.width = abstractKey->width();
+        record.height = abstractKey->height();
+        record.modifierId = nullString;
+        record.label = nullString;
+        record.firstKeyChar = keyCharCount;
+
+        if (Key* const key = qobject_cast<Key*>(abstractKey))
+        {
+            record.type = 0;
+            record.fingerIndex = key->fingerIndex();
+            record.hasHapticMarker = key->hasHapticMarker();
+            record.keyCharCount = key->keyCharCount();
+
+            for (int j = 0; j < key->keyCharCount(); j++)
+            {
+                KeyChar* const keyChar = key->keyChar(j);
+                KeyCharRecord charRecord;
+                charRecord.position = keyChar->position();
+                charRecord.modifier = strings.add(keyChar->modifier());
+                charRecord.value = keyChar->value().unicode();
+                appendRecord(keyChars, charRecord);
+            }
+
+            keyCharCount += key->keyCharCount();
+        }
+        else if (SpecialKey* const specialKey = qobject_cast<SpecialKey*>(abstractKey))
+        {
+            record.type = specialKey->type() + 1;
+            record.modifierId = strings.add(specialKey->modifierId());
+            record.label = strings.add(specialKey->label());
+        }
+
+        appendRecord(records, record);
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.sourceHash, sourceHash.constData(), qMin(sourceHash.size(), sourceHashSize));
+    header.type = KeyboardLayoutCache;
+    header.recordCount = source->keyCount();
+    header.keyCharCount = keyCharCount;
+    header.stringCount = strings.count();
+
+    QByteArray data;
+    appendRecord(data, header);
+    data.append(records);
+    data.append(keyChars);
+    strings.appendTo(data);
+
+    return write(sourcePath, KeyboardLayoutCache, data);
+}
+
+QString ResourceCache::cachePath(const QString& sourcePath, Type type)
+{
+    const QByteArray key = QFileInfo(sourcePath).absoluteFilePath().toUtf8();
+    const QString name = QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex());
+    const QString suffix = type == CourseCache? ".course": ".keyboardlayout";
+    const QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+
+    return dir.filePath("resources/" + name + suffix);
+}
+
+bool ResourceCache::write(const QString& sourcePath, Type type, const QByteArray& data)
+{
+    // fill in the parts of the header which depend on the rest of the file
+    CacheHeader header = recordAt<CacheHeader>(reinterpret_cast<const uchar*>(data.constData()), 0);
+    const QFileInfo sourceInfo(sourcePath);
+    header.magic = cacheMagic;
+    header.version = cacheVersion;
+    header.size = data.size();
+    header.checksum = checksum(reinterpret_cast<const uchar*>(data.constData()) + sizeof(CacheHeader), data.size() - sizeof(CacheHeader));
+    header.sourceModified = sourceInfo.lastModified().toMSecsSinceEpoch();
+    header.sourceSize = sourceInfo.size();
+
+    const QString path = cachePath(sourcePath, type);
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "can't open:" << path;
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+    file.write(data.constData() + sizeof(CacheHeader), data.size() - sizeof(CacheHeader));
+
+    return file.commit();
+}
+
+bool ResourceCache::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_size = m_file.size();
+
+    if (m_size < qint64(sizeof(CacheHeader) + sizeof(ResourceRecord)))
+        return false;
+
+    m_data = m_file.map(0, m_size);
+
+    if (!m_data)
+        return false;
+
+    const CacheHeader header = recordAt<CacheHeader>(m_data, 0);
+
+    if (header.magic != cacheMagic || header.version != cacheVersion || header.type != m_type || header.size != m_size)
+        return false;
+
+    const qint64 recordSize = m_type == CourseCache? sizeof(LessonRecord): sizeof(KeyRecord);
+    const qint64 recordsOffset = sizeof(CacheHeader) + sizeof(ResourceRecord);
+    const qint64 keyCharsOffset = recordsOffset + header.recordCount * recordSize;
+    const qint64 stringsOffset = keyCharsOffset + header.keyCharCount * qint64(sizeof(KeyCharRecord));
+    const qint64 stringDataOffset = stringsOffset + header.stringCount * qint64(sizeof(StringEntry));
+
+    if (stringDataOffset > m_size || (m_size - stringDataOffset) % sizeof(ushort) != 0)
+        return false;
+
+    if (checksum(m_data + sizeof(CacheHeader), m_size - sizeof(CacheHeader)) != header.checksum)
+    {
+        qWarning() << "damaged cache:" << m_file.fileName();
+        return false;
+    }
+
+    m_records = m_data + recordsOffset;
+    m_keyChars = m_data + keyCharsOffset;
+    m_strings = m_data + stringsOffset;
+    m_stringData = reinterpret_cast<const ushort*>(m_data + stringDataOffset);
+    m_stringDataLength = (m_size - stringDataOffset) / sizeof(ushort);
+
+    return true;
+}
+
+QString ResourceCache::lessonText(const QString& key)
+{
+    const QString text = string(key.toUInt());
+
+    if (m_hasError)
+    {
+        qWarning() << "damaged cache:" << m_file.fileName();
+    }
+
+    return text;
+}
+
+bool ResourceCache::hasString(quint32 index) const
+{
+    if (index == nullString)
+        return true;
+
+    const CacheHeader header = recordAt<CacheHeader>(m_data, 0);
+
+    if (index >= header.stringCount)
+        return false;
+
+    const StringEntry entry = recordAt<StringEntry>(m_strings, index);
+
+    return qint64(entry.offset) + entry.length <= m_stringDataLength;
+}
+
+QString ResourceCache::string(quint32 index)
+{
+    if (index == nullString)
+        return QString();
+
+    if (!hasString(index))
+    {
+        m_hasError = true;
+        return QString();
+    }
+
+    const StringEntry entry = recordAt<StringEntry>(m_strings, index);
+
+    return QString(reinterpret_cast<const QChar*>(m_stringData + entry.offset), entry.length);
+}
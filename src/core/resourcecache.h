@@ -0,0 +1,90 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RESOURCECACHE_H
+#define RESOURCECACHE_H
+
+#include <QByteArray>
+#include <QEnableSharedFromThis>
+#include <QFile>
+#include <QString>
+
+#include "lessontextprovider.h"
+
+class Course;
+class KeyboardLayout;
+
+/**
+ * A precompiled binary copy of a built-in course or keyboard layout.
+ *
+ * Cache files live in the cache directory and are named after a hash of
+ * the path of their source. They are memory mapped and read in place: a
+ * versioned header, one record for the resource itself, fixed-size records
+ * for its lessons or keys, an index into the string table and finally the
+ * strings as UTF-16. Numbers are stored in host byte order, caches never
+ * leave the machine.
+ *
+ * When owned by a QSharedPointer the cache stays mapped as long as the
+ * lessons it has been read into, which fetch their texts from it on demand.
+ *
+ * A cache is current as long as its source has the same modification time
+ * and size, or at least the same content hash. If the header or the
+ * checksum of the contents doesn't check out the cache is ignored and the
+ * caller falls back to the XML file.
+ */
+class ResourceCache : public LessonTextProvider, public QEnableSharedFromThis<ResourceCache>
+{
+public:
+    enum Type {
+        CourseCache = 1,
+        KeyboardLayoutCache
+    };
+
+    ResourceCache(const QString& sourcePath, Type type);
+    ~ResourceCache();
+    bool isValid() const;
+    bool isUpToDate() const;
+    bool matches(const QByteArray& sourceHash) const;
+    bool readCourse(Course* target);
+    bool readKeyboardLayout(KeyboardLayout* target);
+    QString lessonText(const QString& key) Q_DECL_OVERRIDE;
+    static bool write(const QString& sourcePath, const QByteArray& sourceHash, Course* source);
+    static bool write(const QString& sourcePath, const QByteArray& sourceHash, KeyboardLayout* source);
+
+private:
+    Q_DISABLE_COPY(ResourceCache)
+    static QString cachePath(const QString& sourcePath, Type type);
+    static bool write(const QString& sourcePath, Type type, const QByteArray& data);
+    bool open();
+    bool hasString(quint32 index) const;
+    QString string(quint32 index);
+    QString m_sourcePath;
+    Type m_type;
+    QFile m_file;
+    const uchar* m_data;
+    qint64 m_size;
+    const uchar* m_records;
+    const uchar* m_keyChars;
+    const uchar* m_strings;
+    const ushort* m_stringData;
+    qint64 m_stringDataLength;
+    bool m_isValid;
+    bool m_hasError;
+};
+
+#endif // RESOURCECACHE_H
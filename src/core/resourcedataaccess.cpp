@@ -17,17 +17,18 @@
 
 #include "resourcedataaccess.h"
 
+#include <QCryptographicHash>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QDomDocument>
 #include <QDomElement>
 #include <QDomNodeList>
-#include <QUrl>
+#include <QLoggingCategory>
+#include <QSharedPointer>
 #include <QStandardPaths>
-#include <QXmlSchema>
-#include <QXmlSchemaValidator>
-
+#include <QXmlStreamReader>
 
 #include "dataindex.h"
 #include "keyboardlayout.h"
@@ -36,6 +37,108 @@
 #include "keychar.h"
 #include "course.h"
 #include "lesson.h"
+#include "resourcecache.h"
+#include "resourcevalidator.h"
+
+Q_LOGGING_CATEGORY(resourceTiming, "ktouch.timing.resources", QtWarningMsg)
+
+// courses and keyboard layouts are read in a single pass, the checks below
+// enforce the same structure as course.xsd and keyboardlayout.xsd
+
+static bool readStartElement(QXmlStreamReader& xml, const QString& name)
+{
+    if (!xml.readNextStartElement())
+    {
+        if (!xml.hasError())
+        {
+            xml.raiseError(QString("missing element <%1>").arg(name));
+        }
+        return false;
+    }
+
+    if (xml.name() != name)
+    {
+        xml.raiseError(QString("expected element <%1>, found <%2>").arg(name, xml.name().toString()));
+        return false;
+    }
+
+    return true;
+}
+
+static bool readEndElement(QXmlStreamReader& xml)
+{
+    if (xml.readNextStartElement())
+    {
+        xml.raiseError(QString("unexpected element <%1>").arg(xml.name().toString()));
+        return false;
+    }
+
+    return !xml.hasError();
+}
+
+static QString readTextElement(QXmlStreamReader& xml, const QString& name)
+{
+    if (!readStartElement(xml, name))
+        return QString();
+
+    return xml.readElementText();
+}
+
+static uint readUIntElement(QXmlStreamReader& xml, const QString& name)
+{
+    const QString text = readTextElement(xml, name);
+
+    if (xml.hasError())
+        return 0;
+
+    bool ok;
+    const uint value = text.trimmed().toUInt(&ok);
+
+    if (!ok)
+    {
+        xml.raiseError(QString("<%1> is not an unsigned integer").arg(name));
+    }
+
+    return value;
+}
+
+static uint uintAttribute(QXmlStreamReader& xml, const QString& name)
+{
+    const QStringRef value = xml.attributes().value(name);
+
+    if (value.isNull())
+    {
+        xml.raiseError(QString("missing attribute %1").arg(name));
+        return 0;
+    }
+
+    bool ok;
+    const uint result = value.toUInt(&ok);
+
+    if (!ok)
+    {
+        xml.raiseError(QString("attribute %1 is not an unsigned integer").arg(name));
+    }
+
+    return result;
+}
+
+static QString enumAttribute(QXmlStreamReader& xml, const QString& name, const char* const values[])
+{
+    const QString value = xml.attributes().value(name).toString();
+
+    for (int i = 0; values[i]; i++)
+    {
+        if (value == QLatin1String(values[i]))
+            return value;
+    }
+
+    xml.raiseError(QString("invalid value '%1' for attribute %2").arg(value, name));
+    return QString();
+}
+
+static const char* const charPositions[] = {"topLeft", "topRight", "bottomLeft", "bottomRight", "hidden", 0};
+static const char* const specialKeyTypes[] = {"tab", "capslock", "shift", "backspace", "return", "space", "other", 0};
 
 ResourceDataAccess::ResourceDataAccess(QObject *parent) :
     QObject(parent)
@@ -44,10 +147,6 @@ ResourceDataAccess::ResourceDataAccess(QObject *parent) :
 
 bool ResourceDataAccess::fillDataIndex(DataIndex* target)
 {
-    QXmlSchema schema = loadXmlSchema("data");
-    if (!schema.isValid())
-        return false;
-
     foreach (const QString& path, QStandardPaths::locateAll(QStandardPaths::DataLocation, "data.xml"))
     {
         QDir dir = QFileInfo(path).dir();
@@ -58,8 +157,9 @@ bool ResourceDataAccess::fillDataIndex(DataIndex* target)
             qWarning() << "can't open:" << path;
             return false;
         }
-        QDomDocument doc = getDomDocument(dataIndexFile, schema);
-        if (doc.isNull())
+        const QByteArray data = dataIndexFile.readAll();
+        QDomDocument doc;
+        if (!ResourceValidator::validate(path, data, "data") || !doc.setContent(data))
         {
             qWarning() << "invalid doc:" << path;
             return false;
@@ -102,6 +202,22 @@ bool ResourceDataAccess::loadKeyboardLayout(const QString &path, KeyboardLayout*
 {
     target->setIsValid(false);
 
+    QElapsedTimer timer;
+    timer.start();
+
+    // only shipped files are cached, their sources aren't expected to change
+    QSharedPointer<ResourceCache> cache;
+    if (ResourceValidator::isBuiltIn(path))
+    {
+        cache.reset(new ResourceCache(path, ResourceCache::KeyboardLayoutCache));
+        if (cache->isUpToDate() && cache->readKeyboardLayout(target))
+        {
+            qCDebug(resourceTiming) << "loaded" << path << "from cache in" << timer.nsecsElapsed() / 1000 << "us";
+            target->setIsValid(true);
+            return true;
+        }
+    }
+
     QFile keyboardLayoutFile;
     keyboardLayoutFile.setFileName(path);
     if (!keyboardLayoutFile.open(QIODevice::ReadOnly))
@@ -109,66 +225,150 @@ bool ResourceDataAccess::loadKeyboardLayout(const QString &path, KeyboardLayout*
         qWarning() << "can't open:" << path;
         return false;
     }
-    QXmlSchema schema = loadXmlSchema("keyboardlayout");
-    if (!schema.isValid())
-        return false;
-    QDomDocument doc = getDomDocument(keyboardLayoutFile, schema);
-    if (doc.isNull())
+    const QByteArray data = keyboardLayoutFile.readAll();
+    QByteArray hash;
+    if (cache)
+    {
+        // the file may have been touched without being changed, then the
+        // cache just gets a new time stamp
+        hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+        const bool isCached = cache->matches(hash) && cache->readKeyboardLayout(target);
+        cache.reset();
+        if (isCached)
+        {
+            ResourceCache::write(path, hash, target);
+            qCDebug(resourceTiming) << "loaded" << path << "from cache in" << timer.nsecsElapsed() / 1000 << "us";
+            target->setIsValid(true);
+            return true;
+        }
+    }
+    if (!ResourceValidator::validate(path, data, "keyboardlayout"))
     {
         qWarning() << "invalid doc:" << path;
         return false;
     }
-    QDomElement root(doc.documentElement());
+    QXmlStreamReader xml(data);
+    if (!readKeyboardLayout(xml, target))
+    {
+        qWarning() << "invalid doc:" << path << "line" << xml.lineNumber() << xml.errorString();
+        return false;
+    }
+    if (!hash.isNull())
+    {
+        ResourceCache::write(path, hash, target);
+    }
 
-    target->clearKeys();
-    target->setId(root.firstChildElement("id").text());
-    target->setTitle(root.firstChildElement("title").text());
-    target->setName(root.firstChildElement("name").text());
-    target->setWidth(root.firstChildElement("width").text().toInt());
-    target->setHeight(root.firstChildElement("height").text().toInt());
-    for (QDomElement keyNode = root.firstChildElement("keys").firstChildElement();
-         !keyNode.isNull();
-         keyNode = keyNode.nextSiblingElement())
+    qCDebug(resourceTiming) << "loaded" << path << "in" << timer.nsecsElapsed() / 1000 << "us";
+
+    target->setIsValid(true);
+    return true;
+}
+
+bool ResourceDataAccess::readKeyboardLayout(QXmlStreamReader& xml, KeyboardLayout* target)
+{
+    if (!readStartElement(xml, "keyboardLayout"))
+        return false;
+
+    const QString id = readTextElement(xml, "id");
+    const QString title = readTextElement(xml, "title");
+    const QString name = readTextElement(xml, "name");
+    const uint width = readUIntElement(xml, "width");
+    const uint height = readUIntElement(xml, "height");
+
+    if (!readStartElement(xml, "keys"))
+        return false;
+
+    // the layout is only touched once the whole file has turned out to be
+    // valid, until then the keys are kept here
+    QList<AbstractKey*> keys;
+
+    while (!xml.hasError() && xml.readNextStartElement())
     {
+        if (xml.name() != "key" && xml.name() != "specialKey")
+        {
+            xml.raiseError(QString("unexpected element <%1>").arg(xml.name().toString()));
+            break;
+        }
+
         AbstractKey* abstractKey;
 
-        if (keyNode.tagName() == "key")
+        const uint left = uintAttribute(xml, "left");
+        const uint top = uintAttribute(xml, "top");
+        const uint keyWidth = uintAttribute(xml, "width");
+        const uint keyHeight = uintAttribute(xml, "height");
+
+        if (xml.name() == "key")
         {
             Key* key = new Key(this);
-            key->setFingerIndex(keyNode.attribute("fingerIndex").toInt());
-            key->setHasHapticMarker(keyNode.attribute("hasHapticMarker") == "true");
-            for (QDomElement charNode = keyNode.firstChildElement("char");
-                 !charNode.isNull();
-                 charNode = charNode.nextSiblingElement("char"))
+            const uint fingerIndex = uintAttribute(xml, "fingerIndex");
+            if (fingerIndex > 7)
+            {
+                xml.raiseError(QString("finger index %1 out of range").arg(fingerIndex));
+            }
+            key->setFingerIndex(fingerIndex);
+            key->setHasHapticMarker(xml.attributes().value("hasHapticMarker") == "true");
+            while (!xml.hasError() && xml.readNextStartElement())
             {
+                if (xml.name() != "char")
+                {
+                    xml.raiseError(QString("unexpected element <%1>").arg(xml.name().toString()));
+                    break;
+                }
                 KeyChar* keyChar = new KeyChar(key);
-                keyChar->setValue(charNode.text().at(0));
-                keyChar->setPositionStr(charNode.attribute("position"));
-                keyChar->setModifier(charNode.attribute("modifier"));
+                keyChar->setPositionStr(enumAttribute(xml, "position", charPositions));
+                keyChar->setModifier(xml.attributes().value("modifier").toString());
+                const QString value = xml.readElementText();
+                if (value.length() != 1)
+                {
+                    xml.raiseError(QString("<char> has to contain exactly one character"));
+                    delete keyChar;
+                    break;
+                }
+                keyChar->setValue(value.at(0));
                 key->addKeyChar(keyChar);
             }
             abstractKey = key;
         }
-        else if (keyNode.tagName() == "specialKey")
+        else
         {
             SpecialKey* specialKey = new SpecialKey(this);
-            specialKey->setTypeStr(keyNode.attribute("type"));
-            specialKey->setModifierId(keyNode.attribute("modifierId"));
-            specialKey->setLabel(keyNode.attribute("label"));
+            specialKey->setTypeStr(enumAttribute(xml, "type", specialKeyTypes));
+            specialKey->setModifierId(xml.attributes().value("modifierId").toString());
+            specialKey->setLabel(xml.attributes().value("label").toString());
+            readEndElement(xml);
             abstractKey = specialKey;
         }
-        else
-        {
-            continue;
-        }
-        abstractKey->setLeft(keyNode.attribute("left").toInt());
-        abstractKey->setTop(keyNode.attribute("top").toInt());
-        abstractKey->setWidth(keyNode.attribute("width").toInt());
-        abstractKey->setHeight(keyNode.attribute("height").toInt());
-        target->addKey(abstractKey);
+        abstractKey->setLeft(left);
+        abstractKey->setTop(top);
+        abstractKey->setWidth(keyWidth);
+        abstractKey->setHeight(keyHeight);
+        keys.append(abstractKey);
+    }
+
+    readEndElement(xml);
+
+    while (!xml.atEnd())
+    {
+        xml.readNext();
+    }
+
+    if (xml.hasError())
+    {
+        qDeleteAll(keys);
+        return false;
+    }
+
+    target->clearKeys();
+    target->setId(id);
+    target->setTitle(title);
+    target->setName(name);
+    target->setWidth(width);
+    target->setHeight(height);
+    foreach (AbstractKey* key, keys)
+    {
+        target->addKey(key);
     }
 
-    target->setIsValid(true);
     return true;
 }
 
@@ -284,6 +484,23 @@ bool ResourceDataAccess::storeKeyboardLayout(const QString& path, KeyboardLayout
 bool ResourceDataAccess::loadCourse(const QString &path, Course* target)
 {
     target->setIsValid(false);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // only shipped files are cached, their sources aren't expected to change
+    QSharedPointer<ResourceCache> cache;
+    if (ResourceValidator::isBuiltIn(path))
+    {
+        cache.reset(new ResourceCache(path, ResourceCache::CourseCache));
+        if (cache->isUpToDate() && cache->readCourse(target))
+        {
+            qCDebug(resourceTiming) << "loaded" << path << "from cache in" << timer.nsecsElapsed() / 1000 << "us";
+            target->setIsValid(true);
+            return true;
+        }
+    }
+
     QFile courseFile;
     courseFile.setFileName(path);
     if (!courseFile.open(QIODevice::ReadOnly))
@@ -291,36 +508,102 @@ bool ResourceDataAccess::loadCourse(const QString &path, Course* target)
         qWarning() << "can't open:" << path;
         return false;
     }
-    QXmlSchema schema = loadXmlSchema("course");
-    if (!schema.isValid())
-        return false;
-    QDomDocument doc = getDomDocument(courseFile, schema);
-    if (doc.isNull())
+    const QByteArray data = courseFile.readAll();
+    QByteArray hash;
+    if (cache)
+    {
+        // the file may have been touched without being changed, then the
+        // cache just gets a new time stamp
+        hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+        const bool isCached = cache->matches(hash) && cache->readCourse(target);
+        cache.reset();
+        if (isCached)
+        {
+            ResourceCache::write(path, hash, target);
+            qCDebug(resourceTiming) << "loaded" << path << "from cache in" << timer.nsecsElapsed() / 1000 << "us";
+            target->setIsValid(true);
+            return true;
+        }
+    }
+    if (!ResourceValidator::validate(path, data, "course"))
     {
         qWarning() << "invalid doc:" << path;
         return false;
     }
-    QDomElement root(doc.documentElement());
+    QXmlStreamReader xml(data);
+    if (!readCourse(xml, target))
+    {
+        qWarning() << "invalid doc:" << path << "line" << xml.lineNumber() << xml.errorString();
+        return false;
+    }
+    if (!hash.isNull())
+    {
+        ResourceCache::write(path, hash, target);
+    }
 
-    target->setId(root.firstChildElement("id").text());
-    target->setTitle(root.firstChildElement("title").text());
-    target->setDescription(root.firstChildElement("description").text());
-    target->setKeyboardLayoutName(root.firstChildElement("keyboardLayout").text());
-    target->clearLessons();
+    qCDebug(resourceTiming) << "loaded" << path << "in" << timer.nsecsElapsed() / 1000 << "us";
+
+    target->setIsValid(true);
+    return true;
+}
+
+bool ResourceDataAccess::readCourse(QXmlStreamReader& xml, Course* target)
+{
+    if (!readStartElement(xml, "course"))
+        return false;
 
-    for (QDomElement lessonNode = root.firstChildElement("lessons").firstChildElement();
-         !lessonNode.isNull();
-         lessonNode = lessonNode.nextSiblingElement())
+    const QString id = readTextElement(xml, "id");
+    const QString title = readTextElement(xml, "title");
+    const QString description = readTextElement(xml, "description");
+    const QString keyboardLayoutName = readTextElement(xml, "keyboardLayout");
+
+    if (!readStartElement(xml, "lessons"))
+        return false;
+
+    // the course is only touched once the whole file has turned out to be
+    // valid, until then the lessons are kept here
+    QList<Lesson*> lessons;
+
+    while (!xml.hasError() && xml.readNextStartElement())
     {
+        if (xml.name() != "lesson")
+        {
+            xml.raiseError(QString("unexpected element <%1>").arg(xml.name().toString()));
+            break;
+        }
+
         Lesson* lesson = new Lesson(this);
-        lesson->setId(lessonNode.firstChildElement("id").text());
-        lesson->setTitle(lessonNode.firstChildElement("title").text());
-        lesson->setNewCharacters(lessonNode.firstChildElement("newCharacters").text());
-        lesson->setText(lessonNode.firstChildElement("text").text());
+        lesson->setId(readTextElement(xml, "id"));
+        lesson->setTitle(readTextElement(xml, "title"));
+        lesson->setNewCharacters(readTextElement(xml, "newCharacters"));
+        lesson->setText(readTextElement(xml, "text"));
+        lessons.append(lesson);
+        readEndElement(xml);
+    }
+
+    readEndElement(xml);
+
+    while (!xml.atEnd())
+    {
+        xml.readNext();
+    }
+
+    if (xml.hasError())
+    {
+        qDeleteAll(lessons);
+        return false;
+    }
+
+    target->setId(id);
+    target->setTitle(title);
+    target->setDescription(description);
+    target->setKeyboardLayoutName(keyboardLayoutName);
+    target->clearLessons();
+    foreach (Lesson* lesson, lessons)
+    {
         target->addLesson(lesson);
     }
 
-    target->setIsValid(true);
     return true;
 }
 
@@ -389,54 +672,3 @@ bool ResourceDataAccess::storeCourse(const QString& path, Course* source)
     file.write(doc.toByteArray());
     return true;
 }
-
-QXmlSchema ResourceDataAccess::loadXmlSchema(const QString &name)
-{
-    QXmlSchema schema;
-    QString relPath = QString("schemata/%1.xsd").arg(name);
-    QFile schemaFile;
-    if (!openResourceFile(relPath, schemaFile))
-    {
-        return schema;
-    }
-    schema.load(&schemaFile, QUrl::fromLocalFile(schemaFile.fileName()));
-    if (!schema.isValid())
-    {
-        qWarning() << schemaFile.fileName() << "is invalid";
-    }
-    return schema;
-}
-
-QDomDocument ResourceDataAccess::getDomDocument(QFile &file, QXmlSchema &schema)
-{
-    QDomDocument doc;
-    QXmlSchemaValidator validator(schema);
-    if (!validator.validate(&file))
-    {
-        return doc;
-    }
-    file.reset();
-    QString errorMsg;
-    if (!doc.setContent(&file, &errorMsg))
-    {
-        qWarning() << errorMsg;
-    }
-    return doc;
-}
-
-bool ResourceDataAccess::openResourceFile(const QString &relPath, QFile& file)
-{
-    QString path = QStandardPaths::locate(QStandardPaths::DataLocation, relPath);
-    if (path.isNull())
-    {
-        qWarning() << "can't find resource:" << relPath;
-        return false;
-    }
-    file.setFileName(path);
-    if (!file.open(QIODevice::ReadOnly))
-    {
-        qWarning() << "can't open" << path;
-        return false;
-    }
-    return true;
-}
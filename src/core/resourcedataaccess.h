@@ -20,9 +20,7 @@
 
 #include <QObject>
 
-class QXmlSchema;
-class QDomDocument;
-class QFile;
+class QXmlStreamReader;
 class DataIndex;
 class KeyboardLayout;
 class Course;
@@ -39,9 +37,8 @@ public:
     Q_INVOKABLE bool storeCourse(const QString& path, Course* source);
 
 private:
-    QXmlSchema loadXmlSchema(const QString& name);
-    QDomDocument getDomDocument(QFile& file, QXmlSchema& schema);
-    bool openResourceFile(const QString& relPath, QFile& file);
+    bool readKeyboardLayout(QXmlStreamReader& xml, KeyboardLayout* target);
+    bool readCourse(QXmlStreamReader& xml, Course* target);
 };
 
 #endif // RESOURCEDATAACCESS_H
@@ -0,0 +1,268 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "resourcevalidator.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QXmlSchema>
+#include <QXmlSchemaValidator>
+
+static const char manifestHeader[] = "ktouch-validated-resources 1";
+
+struct SchemaEntry
+{
+    QString path;
+    QByteArray source;
+    QByteArray hash;
+    QXmlSchema schema;
+    bool isCompiled;
+};
+
+// guards everything below, compiled schemata are shared between threads so
+// validation itself is serialized as well
+static QMutex validatorMutex;
+static QHash<QString, SchemaEntry> schemaCache;
+static QString schemataDir;
+static QStringList builtInDirs;
+static bool hasBuiltInDirs = false;
+static QSet<QByteArray> manifest;
+static bool isManifestLoaded = false;
+
+static QString manifestPath()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("validated-resources");
+}
+
+static void loadManifest()
+{
+    if (isManifestLoaded)
+        return;
+
+    isManifestLoaded = true;
+
+    QFile file(manifestPath());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    if (file.readLine().trimmed() != manifestHeader)
+    {
+        // written by an incompatible version, start over
+        file.close();
+        file.remove();
+        return;
+    }
+
+    while (!file.atEnd())
+    {
+        const QByteArray line = file.readLine().trimmed();
+
+        if (line.length() == 2 * 20)
+        {
+            manifest.insert(line);
+        }
+    }
+}
+
+static void addToManifest(const QByteArray& key)
+{
+    manifest.insert(key);
+
+    const QString path = manifestPath();
+    QDir().mkpath(QFileInfo(path).path());
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        qWarning() << "can't open:" << path;
+        return;
+    }
+
+    if (file.size() == 0)
+    {
+        file.write(manifestHeader);
+        file.write("\n");
+    }
+
+    file.write(key + '\n');
+}
+
+static SchemaEntry* schemaEntry(const QString& name)
+{
+    QHash<QString, SchemaEntry>::iterator it = schemaCache.find(name);
+
+    if (it != schemaCache.end())
+        return it->path.isNull()? 0: &it.value();
+
+    SchemaEntry entry;
+    entry.isCompiled = false;
+
+    const QString fileName = QString("%1.xsd").arg(name);
+    const QString path = schemataDir.isNull()?
+        QStandardPaths::locate(QStandardPaths::DataLocation, "schemata/" + fileName):
+        QDir(schemataDir).filePath(fileName);
+    QFile file(path);
+
+    if (path.isNull() || !file.exists())
+    {
+        qWarning() << "can't find resource:" << fileName;
+    }
+    else if (!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "can't open" << path;
+    }
+    else
+    {
+        entry.path = path;
+        entry.source = file.readAll();
+        entry.hash = QCryptographicHash::hash(entry.source, QCryptographicHash::Sha1);
+    }
+
+    // missing schemata are remembered as well, so they are reported only once
+    it = schemaCache.insert(name, entry);
+    return entry.path.isNull()? 0: &it.value();
+}
+
+static QXmlSchema& compiledSchema(SchemaEntry* entry)
+{
+    if (!entry->isCompiled)
+    {
+        entry->schema.load(entry->source, QUrl::fromLocalFile(entry->path));
+        entry->source.clear();
+        entry->isCompiled = true;
+
+        if (!entry->schema.isValid())
+        {
+            qWarning() << entry->path << "is invalid";
+        }
+    }
+
+    return entry->schema;
+}
+
+static bool isBuiltInPath(const QString& path)
+{
+    const QString canonicalPath = QFileInfo(path).canonicalFilePath();
+
+    if (canonicalPath.isEmpty())
+        return false;
+
+    QStringList dirs = builtInDirs;
+
+    if (!hasBuiltInDirs)
+    {
+        dirs = QStandardPaths::standardLocations(QStandardPaths::DataLocation);
+        dirs.removeAll(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
+    }
+
+    foreach (const QString& dir, dirs)
+    {
+        const QString canonicalDir = QFileInfo(dir).canonicalFilePath();
+
+        if (!canonicalDir.isEmpty() && canonicalPath.startsWith(canonicalDir + '/'))
+            return true;
+    }
+
+    return false;
+}
+
+bool ResourceValidator::validate(const QString& path, const QByteArray& data, const QString& schemaName)
+{
+    QMutexLocker locker(&validatorMutex);
+
+    SchemaEntry* entry = schemaEntry(schemaName);
+
+    if (!entry)
+        return false;
+
+    const bool builtIn = isBuiltInPath(path);
+    QByteArray key;
+
+    if (builtIn)
+    {
+        // the schema is part of the key, so files are validated again once
+        // it changes
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(entry->hash);
+        hash.addData(data);
+        key = hash.result().toHex();
+
+        loadManifest();
+
+        if (manifest.contains(key))
+            return true;
+    }
+
+    QXmlSchema& schema = compiledSchema(entry);
+
+    if (!schema.isValid())
+        return false;
+
+    QXmlSchemaValidator validator(schema);
+
+    if (!validator.validate(data, QUrl::fromLocalFile(path)))
+        return false;
+
+    if (builtIn)
+    {
+        addToManifest(key);
+    }
+
+    return true;
+}
+
+QXmlSchema ResourceValidator::schema(const QString& name)
+{
+    QMutexLocker locker(&validatorMutex);
+
+    SchemaEntry* entry = schemaEntry(name);
+
+    return entry? compiledSchema(entry): QXmlSchema();
+}
+
+bool ResourceValidator::isBuiltIn(const QString& path)
+{
+    QMutexLocker locker(&validatorMutex);
+
+    return isBuiltInPath(path);
+}
+
+void ResourceValidator::setSchemataDir(const QString& dir)
+{
+    QMutexLocker locker(&validatorMutex);
+
+    schemataDir = dir;
+    schemaCache.clear();
+}
+
+void ResourceValidator::setBuiltInDirs(const QStringList& dirs)
+{
+    QMutexLocker locker(&validatorMutex);
+
+    builtInDirs = dirs;
+    hasBuiltInDirs = true;
+}
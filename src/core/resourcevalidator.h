@@ -0,0 +1,57 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RESOURCEVALIDATOR_H
+#define RESOURCEVALIDATOR_H
+
+#include <QStringList>
+
+class QByteArray;
+class QXmlSchema;
+
+/**
+ * Validates resource files against the schemata in src/schemata.
+ *
+ * Compiled schemata are kept for the lifetime of the process. Files below
+ * the system data directories are only validated the first time they are
+ * seen: their content hash is then remembered in a manifest in the cache
+ * directory and later runs accept them without compiling a schema at all.
+ * Every other file, e.g. an imported course, is validated on each load.
+ *
+ * All functions may be called from any thread.
+ */
+class ResourceValidator
+{
+public:
+    static bool validate(const QString& path, const QByteArray& data, const QString& schemaName);
+    static QXmlSchema schema(const QString& name);
+    static bool isBuiltIn(const QString& path);
+
+    /**
+     * Override where schemata and built-in files are looked for, instead of
+     * the data directories of the application. Useful when working from a
+     * source tree.
+     */
+    static void setSchemataDir(const QString& dir);
+    static void setBuiltInDirs(const QStringList& dirs);
+
+private:
+    ResourceValidator();
+};
+
+#endif // RESOURCEVALIDATOR_H
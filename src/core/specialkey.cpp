@@ -92,6 +92,7 @@ void SpecialKey::setType(SpecialKey::Type type)
     if(type != m_type)
     {
         m_type = type;
+        setIsModified(true);
         emit typeChanged();
     }
 }
@@ -106,6 +107,7 @@ void SpecialKey::setModifierId(const QString& modifierId)
     if(modifierId != m_modifierId)
     {
         m_modifierId = modifierId;
+        setIsModified(true);
         emit modifierIdChanged();
     }
 }
@@ -120,6 +122,7 @@ void SpecialKey::setLabel(const QString& label)
     if(label != m_label)
     {
         m_label = label;
+        setIsModified(true);
         emit labelChanged();
     }
 }
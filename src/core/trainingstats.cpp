@@ -17,19 +17,21 @@
 
 #include "trainingstats.h"
 
-#include <QDateTime>
 #include <QTimer>
 
 TrainingStats::TrainingStats(QObject* parent) :
     QObject(parent),
     m_timeIsRunning(false),
     m_charactersTyped(0),
-    m_elapsedTime(0),
+    m_elapsedNSecs(0),
     m_errorCount(0),
     m_isValid(true),
-    m_startTime(0),
     m_updateTimer(new QTimer(this))
 {
+    // room for the keystrokes of a long lesson, reserve() makes sure there
+    // is enough for every line
+    m_keystrokeTimestamps.reserve(4096);
+
     connect(m_updateTimer, SIGNAL(timeout()), SLOT(update()));
 }
 
@@ -49,27 +51,47 @@ void TrainingStats::setCharactersTyped(int charactesTyped)
 
 QTime TrainingStats::elapsedTime() const
 {
-    return QTime(0, 0).addMSecs(m_elapsedTime);
+    return QTime(0, 0).addMSecs(elapsedNSecs() / 1000000);
 }
 
 void TrainingStats::setElapsedTime(const QTime& elapsedTime)
 {
-    quint64 msec = elapsedTime.msec();
+    setElapsedTime(quint64(QTime(0, 0).msecsTo(elapsedTime)));
+}
+
+void TrainingStats::setElapsedTime(const quint64& msec)
+{
+    const qint64 nsecs = msec * 1000000;
 
-    if(msec != m_elapsedTime)
+    if(nsecs != m_elapsedNSecs)
     {
-        m_elapsedTime = msec;
+        m_elapsedNSecs = nsecs;
+
+        if (m_timeIsRunning)
+        {
+            m_elapsedTimer.start();
+        }
+
         emit statsChanged();
     }
 }
 
-void TrainingStats::setElapsedTime(const quint64& msec)
+qint64 TrainingStats::elapsedNSecs() const
 {
-    if(msec != m_elapsedTime)
+    // measured with a monotonic clock, so adjustments of the system time
+    // don't affect the result
+
+    if (m_timeIsRunning)
     {
-        m_elapsedTime = msec;
-        emit statsChanged();
+        return m_elapsedNSecs + m_elapsedTimer.nsecsElapsed();
     }
+
+    return m_elapsedNSecs;
+}
+
+const QVector<qint64>& TrainingStats::keystrokeTimestamps() const
+{
+    return m_keystrokeTimestamps;
 }
 
 int TrainingStats::errorCount() const
@@ -99,17 +121,23 @@ void TrainingStats::setIsValid(bool isValid)
         emit isValidChanged();
     }
 }
-QMap< QString, int > TrainingStats::errorMap() const
+
+const ErrorHistogram& TrainingStats::errorHistogram() const
 {
-    return m_errorMap;
+    return m_errorHistogram;
 }
 
-void TrainingStats::setErrorMap(const QMap< QString, int >& errorMap)
+void TrainingStats::setErrorHistogram(const ErrorHistogram& errorHistogram)
 {
-    m_errorMap = errorMap;
+    m_errorHistogram = errorHistogram;
     emit errorsChanged();
 }
 
+const KeystrokeJournal& TrainingStats::keystrokeJournal() const
+{
+    return m_keystrokeJournal;
+}
+
 bool TrainingStats::timeIsRunning() const
 {
     return m_timeIsRunning;
@@ -120,7 +148,7 @@ void TrainingStats::startTraining()
     if (!m_timeIsRunning)
     {
         m_timeIsRunning = true;
-        m_startTime = QDateTime::currentMSecsSinceEpoch() - m_elapsedTime;
+        m_elapsedTimer.start();
         update();
     }
 }
@@ -129,6 +157,8 @@ void TrainingStats::stopTraining()
 {
     if (m_timeIsRunning)
     {
+        m_elapsedNSecs += m_elapsedTimer.nsecsElapsed();
+        m_elapsedTimer.invalidate();
         m_timeIsRunning = false;
         update();
     }
@@ -138,14 +168,19 @@ void TrainingStats::reset()
 {
     stopTraining();
     m_charactersTyped = 0;
-    m_elapsedTime = 0;
+    m_elapsedNSecs = 0;
+    m_keystrokeTimestamps.resize(0);
     m_errorCount = 0;
-    m_errorMap.clear();
+    m_errorHistogram.clear();
+    m_keystrokeJournal.clear();
     statsChanged();
+    emit errorsChanged();
 }
 
-void TrainingStats::logCharacter(QString character, EventType type)
+void TrainingStats::logCharacter(QChar character, EventType type)
 {
+    m_keystrokeTimestamps.append(elapsedNSecs());
+
     if (type == TrainingStats::CorrectCharacter)
     {
         m_charactersTyped++;
@@ -153,17 +188,44 @@ void TrainingStats::logCharacter(QString character, EventType type)
     else
     {
         m_errorCount++;
-        if (m_errorMap.contains(character))
-        {
-            m_errorMap[character]++;
-        }
-        else
-        {
-            m_errorMap[character] = 1;
-        }
+        m_errorHistogram.increment(character.unicode());
+        emit errorLogged(character.unicode());
+    }
+}
 
-        emit errorsChanged();
+void TrainingStats::logCharacter(const QString& character, EventType type)
+{
+    if (character.isEmpty())
+        return;
+
+    logCharacter(character.at(0), type);
+}
+
+void TrainingStats::logKeystroke(QChar expected, QChar typed)
+{
+    m_keystrokeJournal.append(elapsedNSecs() / 1000000, expected.unicode(), typed.unicode());
+}
+
+void TrainingStats::logCorrection()
+{
+    m_keystrokeJournal.appendCorrection(elapsedNSecs() / 1000000);
+}
+
+void TrainingStats::reserve(const QString& text)
+{
+    // called before a line is typed, so logging its characters doesn't have
+    // to allocate as long as each of them is typed wrong at most once
+
+    const int count = 2 * text.length();
+    const int required = m_keystrokeTimestamps.size() + count;
+
+    if (m_keystrokeTimestamps.capacity() < required)
+    {
+        m_keystrokeTimestamps.reserve(qMax(required, 2 * m_keystrokeTimestamps.capacity()));
     }
+
+    m_errorHistogram.reserve(text);
+    m_keystrokeJournal.reserve(count);
 }
 
 float TrainingStats::accuracy()
@@ -178,21 +240,24 @@ float TrainingStats::accuracy()
 
 int TrainingStats::charactersPerMinute()
 {
-    if (m_elapsedTime == 0)
+    const qint64 nsecs = elapsedNSecs();
+
+    if (nsecs == 0)
     {
         return 0;
     }
 
-    return m_charactersTyped * 60000 / m_elapsedTime;
+    return qint64(m_charactersTyped) * Q_INT64_C(60000000000) / nsecs;
 }
 
 void TrainingStats::update()
 {
+    // the timer only refreshes the displayed values, the elapsed time
+    // itself is exact whenever it is read
+
     m_updateTimer->stop();
     if (m_timeIsRunning)
     {
-        qint64 now = QDateTime::currentMSecsSinceEpoch();
-        m_elapsedTime = now - m_startTime;
         m_updateTimer->start(200);
     }
     emit statsChanged();
@@ -20,10 +20,14 @@
 
 #include <QObject>
 #include <QChar>
+#include <QElapsedTimer>
 #include <QTime>
-#include <QMap>
+#include <QVector>
 #include <QString>
 
+#include "errorhistogram.h"
+#include "keystrokejournal.h"
+
 class QTimer;
 
 class TrainingStats : public QObject
@@ -50,17 +54,24 @@ public:
     QTime elapsedTime() const;
     void setElapsedTime(const QTime& elapsedTime);
     void setElapsedTime(const quint64& msec);
+    qint64 elapsedNSecs() const;
+    const QVector<qint64>& keystrokeTimestamps() const;
     int errorCount() const;
     void setErrorCount(int errorCount);
     bool isValid() const;
     void setIsValid(bool isValid);
-    QMap<QString, int> errorMap() const;
-    void setErrorMap(const QMap<QString, int>& errorMap);
+    const ErrorHistogram& errorHistogram() const;
+    void setErrorHistogram(const ErrorHistogram& errorHistogram);
+    const KeystrokeJournal& keystrokeJournal() const;
     bool timeIsRunning() const;
     Q_INVOKABLE void startTraining();
     Q_INVOKABLE void stopTraining();
     Q_INVOKABLE void reset();
-    Q_INVOKABLE void logCharacter(QString character, EventType type);
+    void logCharacter(QChar character, EventType type);
+    Q_INVOKABLE void logCharacter(const QString& character, EventType type);
+    void logKeystroke(QChar expected, QChar typed);
+    void logCorrection();
+    void reserve(const QString& text);
     float accuracy();
     int charactersPerMinute();
 
@@ -68,16 +79,19 @@ signals:
     void statsChanged();
     void isValidChanged();
     void errorsChanged();
+    void errorLogged(uint codepoint);
 
 private:
     Q_SLOT void update();
     bool m_timeIsRunning;
     int m_charactersTyped;
-    quint64 m_elapsedTime;
+    qint64 m_elapsedNSecs;
+    QElapsedTimer m_elapsedTimer;
+    QVector<qint64> m_keystrokeTimestamps;
     int m_errorCount;
     bool m_isValid;
-    QMap<QString, int> m_errorMap;
-    quint64 m_startTime;
+    ErrorHistogram m_errorHistogram;
+    KeystrokeJournal m_keystrokeJournal;
     QTimer* m_updateTimer;
 };
 
@@ -0,0 +1,756 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "trainingstatswriter.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QTimer>
+#include <QVariant>
+
+#include "preferences.h"
+
+// the number of records which may wait for the writer before it is
+// considered to have fallen behind, only reached if the disk stalls for a
+// long time or writing keeps failing
+static const int MaxQueuedRecords = 64;
+
+// how long the writer waits before it tries to write a failed batch again,
+// doubled after every failed attempt up to the maximum
+static const int InitialRetryInterval = 1000;
+static const int MaxRetryInterval = 60000;
+
+// how long the writer has to be idle before it checkpoints the WAL
+static const int CheckpointIdleInterval = 5000;
+
+// old sessions are rolled up some time after startup, so they don't compete
+// with loading the home screen, and then in small steps until all are done
+static const int RollUpStartDelay = 30000;
+static const int RollUpInterval = 1000;
+static const int RollUpBatchSize = 200;
+
+enum RollupPeriod
+{
+    DailyRollup = 1,
+    WeeklyRollup
+};
+
+static qint64 periodStart(qint64 date, RollupPeriod period)
+{
+    QDate day = QDateTime::fromMSecsSinceEpoch(date).date();
+
+    if (period == WeeklyRollup)
+    {
+        day = day.addDays(1 - day.dayOfWeek());
+    }
+
+    return QDateTime(day).toMSecsSinceEpoch();
+}
+
+TrainingStatsWriter::TrainingStatsWriter() :
+    DbAccess(0),
+    m_thread(new QThread()),
+    m_checkpointTimer(new QTimer(this)),
+    m_rollUpTimer(new QTimer(this)),
+    m_retryTimer(new QTimer(this)),
+    m_retryInterval(InitialRetryInterval),
+    m_flushScheduled(false),
+    m_queueOverflowed(false),
+    m_hasWritten(false),
+    m_hasRolledUp(false)
+{
+    m_checkpointTimer->setSingleShot(true);
+    m_checkpointTimer->setInterval(CheckpointIdleInterval);
+    connect(m_checkpointTimer, SIGNAL(timeout()), SLOT(checkpoint()));
+
+    m_rollUpTimer->setSingleShot(true);
+    m_rollUpTimer->setInterval(RollUpStartDelay);
+    connect(m_rollUpTimer, SIGNAL(timeout()), SLOT(rollUp()));
+
+    m_retryTimer->setSingleShot(true);
+    connect(m_retryTimer, SIGNAL(timeout()), SLOT(flush()));
+
+    m_thread->setObjectName("TrainingStatsWriter");
+    moveToThread(m_thread);
+    m_thread->start();
+
+    // the timer belongs to the writer thread now and has to be started there
+    QMetaObject::invokeMethod(m_rollUpTimer, "start", Qt::QueuedConnection);
+}
+
+TrainingStatsWriter::~TrainingStatsWriter()
+{
+    shutdown();
+    delete m_thread;
+}
+
+void TrainingStatsWriter::enqueue(const TrainingStatsRecord& record)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // never wait for the writer, the queue just keeps growing while it is
+    // behind
+
+    m_queue.enqueue(record);
+
+    if (m_queue.size() > MaxQueuedRecords && !m_queueOverflowed)
+    {
+        m_queueOverflowed = true;
+        qWarning() << "training stats writer has fallen behind," << m_queue.size() << "records are waiting to be saved";
+    }
+
+    if (!m_flushScheduled)
+    {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+}
+
+void TrainingStatsWriter::shutdown()
+{
+    if (!m_thread->isRunning())
+        return;
+
+    // write the remaining records and release the connection in the writer
+    // thread, the connection can't be closed from any other thread
+
+    QMetaObject::invokeMethod(this, "flush", Qt::BlockingQueuedConnection);
+    QMetaObject::invokeMethod(this, "closeConnection", Qt::BlockingQueuedConnection);
+
+    m_thread->quit();
+    m_thread->wait();
+}
+
+void TrainingStatsWriter::flush()
+{
+    QList<TrainingStatsRecord> records;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        records.swap(m_queue);
+        m_flushScheduled = false;
+        m_queueOverflowed = false;
+    }
+
+    m_retryTimer->stop();
+
+    if (records.isEmpty())
+        return;
+
+    m_hasWritten = true;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!writeRecords(records))
+    {
+        // put the batch back in front of the records enqueued meanwhile and
+        // try again later, the flush scheduled by the retry timer keeps
+        // enqueue() from scheduling one of its own until then
+
+        {
+            QMutexLocker locker(&m_mutex);
+            records.append(m_queue);
+            records.swap(m_queue);
+            m_flushScheduled = true;
+        }
+
+        // a connection which failed to open is never opened again by
+        // database(), it has to be removed first
+        if (!database().isOpen())
+        {
+            closeDatabase();
+        }
+
+        qWarning() << "failed to save training stats records, retrying in" << m_retryInterval / 1000 << "s";
+        emit recordsNotSaved(errorMessage());
+
+        m_retryTimer->start(m_retryInterval);
+        m_retryInterval = qMin(2 * m_retryInterval, MaxRetryInterval);
+        return;
+    }
+
+    qCDebug(dbTiming) << "saved" << records.size() << "training stats records in" << timer.nsecsElapsed() / 1000 << "us";
+
+    m_retryInterval = InitialRetryInterval;
+    emit recordsSaved();
+
+    m_checkpointTimer->start();
+}
+
+void TrainingStatsWriter::checkpoint()
+{
+    // a passive checkpoint never waits for readers, whatever it can't copy
+    // now is copied by the next one
+
+    QSqlDatabase db = database();
+
+    if (!db.isOpen())
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    db.exec("PRAGMA wal_checkpoint(PASSIVE)");
+
+    if (db.lastError().isValid())
+    {
+        qWarning() << db.lastError().text();
+        return;
+    }
+
+    qCDebug(dbTiming) << "checkpointed WAL in" << timer.nsecsElapsed() / 1000 << "us";
+}
+
+void TrainingStatsWriter::rollUp()
+{
+    const int detailedHistoryDays = Preferences::detailedHistoryDays();
+
+    if (detailedHistoryDays == 0)
+        return;
+
+    const QDateTime now = QDateTime::currentDateTime();
+    const qint64 detailedCutoff = now.addDays(-detailedHistoryDays).toMSecsSinceEpoch();
+    const qint64 dailyCutoff = now.addDays(-qMax(detailedHistoryDays, Preferences::dailyHistoryDays())).toMSecsSinceEpoch();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int sessionCount = 0;
+    int dailyTotalCount = 0;
+
+    if (!rollUpSessions(detailedCutoff, dailyCutoff, &sessionCount))
+        return;
+
+    if (!rollUpDailyTotals(dailyCutoff, &dailyTotalCount))
+        return;
+
+    qCDebug(dbTiming) << "rolled up" << sessionCount << "sessions and" << dailyTotalCount << "daily totals in" << timer.nsecsElapsed() / 1000 << "us";
+
+    if (sessionCount > 0 || dailyTotalCount > 0)
+    {
+        m_hasRolledUp = true;
+    }
+
+    if (sessionCount == RollUpBatchSize || dailyTotalCount == RollUpBatchSize)
+    {
+        m_rollUpTimer->start(RollUpInterval);
+        return;
+    }
+
+    // the charts only have to be reloaded once all the work is done
+    if (m_hasRolledUp)
+    {
+        m_hasRolledUp = false;
+        emit recordsSaved();
+    }
+}
+
+void TrainingStatsWriter::closeConnection()
+{
+    m_checkpointTimer->stop();
+    m_rollUpTimer->stop();
+    m_retryTimer->stop();
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (!m_queue.isEmpty())
+        {
+            qWarning() << m_queue.size() << "training stats records could not be saved before shutdown";
+        }
+    }
+
+    // leave an empty WAL behind so the next start doesn't have to replay it
+
+    if (m_hasWritten)
+    {
+        QSqlDatabase db = database();
+
+        if (db.isOpen())
+        {
+            db.exec("PRAGMA wal_checkpoint(TRUNCATE)");
+
+            if (db.lastError().isValid())
+            {
+                qWarning() << db.lastError().text();
+            }
+        }
+    }
+
+    closeDatabase();
+}
+
+bool TrainingStatsWriter::writeRecords(const QList<TrainingStatsRecord>& records)
+{
+    QSqlDatabase db = database();
+
+    if (!db.isOpen())
+        return false;
+
+    if (!db.transaction())
+    {
+        qWarning() <<  db.lastError().text();
+        raiseError(db.lastError());
+        return false;
+    }
+
+    QSqlQuery addQuery(db);
+
+    if (!prepareQuery(addQuery, "INSERT INTO training_stats (profile_id, course_id, lesson_id, date, characters_typed, error_count, elapsed_time, errors) VALUES (?, ?, ?, ?, ?, ?, ?, ?)"))
+    {
+        qWarning() <<  addQuery.lastError().text();
+        raiseError(addQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    QSqlQuery addKeystrokesQuery(db);
+
+    if (!prepareQuery(addKeystrokesQuery, "INSERT INTO training_stats_keystrokes (stats_id, keystrokes) VALUES (?, ?)"))
+    {
+        qWarning() <<  addKeystrokesQuery.lastError().text();
+        raiseError(addKeystrokesQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    QSqlQuery addSummaryQuery(db);
+
+    if (!prepareQuery(addSummaryQuery, "INSERT OR IGNORE INTO profile_summary (profile_id, lessons_trained, total_training_time, last_training_session) VALUES (?, 0, 0, 0)"))
+    {
+        qWarning() <<  addSummaryQuery.lastError().text();
+        raiseError(addSummaryQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    QSqlQuery updateSummaryQuery(db);
+
+    if (!prepareQuery(updateSummaryQuery, "UPDATE profile_summary SET lessons_trained = lessons_trained + 1, total_training_time = total_training_time + ?, last_training_session = MAX(last_training_session, ?) WHERE profile_id = ?"))
+    {
+        qWarning() <<  updateSummaryQuery.lastError().text();
+        raiseError(updateSummaryQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    foreach (const TrainingStatsRecord& record, records)
+    {
+        addQuery.bindValue(0, record.profileId);
+        addQuery.bindValue(1, record.courseId);
+        addQuery.bindValue(2, record.lessonId);
+        addQuery.bindValue(3, record.date);
+        addQuery.bindValue(4, record.charactersTyped);
+        addQuery.bindValue(5, record.errorCount);
+        addQuery.bindValue(6, record.elapsedTime);
+        addQuery.bindValue(7, record.errorHistogram.toByteArray());
+
+        if (!addQuery.exec())
+        {
+            qWarning() <<  addQuery.lastError().text();
+            raiseError(addQuery.lastError());
+            db.rollback();
+            return false;
+        }
+
+        if (!record.keystrokes.isEmpty())
+        {
+            addKeystrokesQuery.bindValue(0, addQuery.lastInsertId());
+            addKeystrokesQuery.bindValue(1, record.keystrokes);
+
+            if (!addKeystrokesQuery.exec())
+            {
+                qWarning() <<  addKeystrokesQuery.lastError().text();
+                raiseError(addKeystrokesQuery.lastError());
+                db.rollback();
+                return false;
+            }
+        }
+
+        addSummaryQuery.bindValue(0, record.profileId);
+
+        if (!addSummaryQuery.exec())
+        {
+            qWarning() <<  addSummaryQuery.lastError().text();
+            raiseError(addSummaryQuery.lastError());
+            db.rollback();
+            return false;
+        }
+
+        updateSummaryQuery.bindValue(0, record.elapsedTime);
+        updateSummaryQuery.bindValue(1, record.date);
+        updateSummaryQuery.bindValue(2, record.profileId);
+
+        if (!updateSummaryQuery.exec())
+        {
+            qWarning() <<  updateSummaryQuery.lastError().text();
+            raiseError(updateSummaryQuery.lastError());
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (!db.commit())
+    {
+        qWarning() <<  db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    return true;
+}
+
+bool TrainingStatsWriter::rollUpSessions(qint64 detailedCutoff, qint64 dailyCutoff, int* count)
+{
+    *count = 0;
+
+    QSqlDatabase db = database();
+
+    if (!db.isOpen())
+        return false;
+
+    if (!db.transaction())
+    {
+        qWarning() <<  db.lastError().text();
+        raiseError(db.lastError());
+        return false;
+    }
+
+    // the latest session of a lesson is left alone, it is the reference the
+    // next session of that lesson is compared with
+
+    QSqlQuery selectQuery(db);
+
+    if (!prepareQuery(selectQuery, "SELECT id, profile_id, course_id, lesson_id, date, characters_typed, error_count, elapsed_time FROM training_stats t "
+                                   "WHERE date < ? AND EXISTS (SELECT 1 FROM training_stats n WHERE n.profile_id = t.profile_id AND n.course_id = t.course_id AND n.lesson_id = t.lesson_id AND n.date > t.date) "
+                                   "ORDER BY id LIMIT ?"))
+    {
+        qWarning() <<  selectQuery.lastError().text();
+        raiseError(selectQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    selectQuery.bindValue(0, detailedCutoff);
+    selectQuery.bindValue(1, RollUpBatchSize);
+
+    if (!selectQuery.exec())
+    {
+        qWarning() <<  selectQuery.lastError().text();
+        raiseError(selectQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    QList<TrainingStatsRecord> sessions;
+    QList<int> sessionIds;
+
+    while (selectQuery.next())
+    {
+        TrainingStatsRecord session;
+        session.profileId = selectQuery.value(1).toInt();
+        session.courseId = selectQuery.value(2).toString();
+        session.lessonId = selectQuery.value(3).toString();
+        session.date = selectQuery.value(4).toLongLong();
+        session.charactersTyped = selectQuery.value(5).toInt();
+        session.errorCount = selectQuery.value(6).toInt();
+        session.elapsedTime = selectQuery.value(7).toInt();
+
+        sessionIds.append(selectQuery.value(0).toInt());
+        sessions.append(session);
+    }
+
+    selectQuery.finish();
+
+    if (sessions.isEmpty())
+    {
+        db.rollback();
+        return true;
+    }
+
+    QSqlQuery addRollupQuery(db);
+    QSqlQuery updateRollupQuery(db);
+    QSqlQuery removeSessionQuery(db);
+    QSqlQuery removeKeystrokesQuery(db);
+
+    if (!prepareQuery(addRollupQuery, "INSERT OR IGNORE INTO training_stats_rollups (profile_id, course_id, lesson_id, period, date, session_count, characters_typed, error_count, elapsed_time, min_speed, max_speed) VALUES (?, ?, ?, ?, ?, 0, 0, 0, 0, 2147483647, 0)"))
+    {
+        qWarning() <<  addRollupQuery.lastError().text();
+        raiseError(addRollupQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    if (!prepareQuery(updateRollupQuery, "UPDATE training_stats_rollups SET session_count = session_count + 1, characters_typed = characters_typed + ?, error_count = error_count + ?, elapsed_time = elapsed_time + ?, min_speed = MIN(min_speed, ?), max_speed = MAX(max_speed, ?) "
+                                         "WHERE profile_id = ? AND course_id = ? AND lesson_id = ? AND period = ? AND date = ?"))
+    {
+        qWarning() <<  updateRollupQuery.lastError().text();
+        raiseError(updateRollupQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    if (!prepareQuery(removeSessionQuery, "DELETE FROM training_stats WHERE id = ?"))
+    {
+        qWarning() <<  removeSessionQuery.lastError().text();
+        raiseError(removeSessionQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    if (!prepareQuery(removeKeystrokesQuery, "DELETE FROM training_stats_keystrokes WHERE stats_id = ?"))
+    {
+        qWarning() <<  removeKeystrokesQuery.lastError().text();
+        raiseError(removeKeystrokesQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    for (int i = 0; i < sessions.count(); i++)
+    {
+        const TrainingStatsRecord& session = sessions.at(i);
+        const RollupPeriod period = session.date < dailyCutoff? WeeklyRollup: DailyRollup;
+        const qint64 date = periodStart(session.date, period);
+        const int speed = session.elapsedTime > 0? qint64(session.charactersTyped) * 60000 / session.elapsedTime: 0;
+
+        addRollupQuery.bindValue(0, session.profileId);
+        addRollupQuery.bindValue(1, session.courseId);
+        addRollupQuery.bindValue(2, session.lessonId);
+        addRollupQuery.bindValue(3, period);
+        addRollupQuery.bindValue(4, date);
+
+        if (!addRollupQuery.exec())
+        {
+            qWarning() <<  addRollupQuery.lastError().text();
+            raiseError(addRollupQuery.lastError());
+            db.rollback();
+            return false;
+        }
+
+        updateRollupQuery.bindValue(0, session.charactersTyped);
+        updateRollupQuery.bindValue(1, session.errorCount);
+        updateRollupQuery.bindValue(2, session.elapsedTime);
+        updateRollupQuery.bindValue(3, speed);
+        updateRollupQuery.bindValue(4, speed);
+        updateRollupQuery.bindValue(5, session.profileId);
+        updateRollupQuery.bindValue(6, session.courseId);
+        updateRollupQuery.bindValue(7, session.lessonId);
+        updateRollupQuery.bindValue(8, period);
+        updateRollupQuery.bindValue(9, date);
+
+        if (!updateRollupQuery.exec())
+        {
+            qWarning() <<  updateRollupQuery.lastError().text();
+            raiseError(updateRollupQuery.lastError());
+            db.rollback();
+            return false;
+        }
+
+        removeSessionQuery.bindValue(0, sessionIds.at(i));
+
+        if (!removeSessionQuery.exec())
+        {
+            qWarning() <<  removeSessionQuery.lastError().text();
+            raiseError(removeSessionQuery.lastError());
+            db.rollback();
+            return false;
+        }
+
+        removeKeystrokesQuery.bindValue(0, sessionIds.at(i));
+
+        if (!removeKeystrokesQuery.exec())
+        {
+            qWarning() <<  removeKeystrokesQuery.lastError().text();
+            raiseError(removeKeystrokesQuery.lastError());
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (!db.commit())
+    {
+        qWarning() <<  db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    m_hasWritten = true;
+    *count = sessions.count();
+
+    return true;
+}
+
+bool TrainingStatsWriter::rollUpDailyTotals(qint64 dailyCutoff, int* count)
+{
+    *count = 0;
+
+    QSqlDatabase db = database();
+
+    if (!db.isOpen())
+        return false;
+
+    if (!db.transaction())
+    {
+        qWarning() <<  db.lastError().text();
+        raiseError(db.lastError());
+        return false;
+    }
+
+    QSqlQuery selectQuery(db);
+
+    if (!prepareQuery(selectQuery, "SELECT id, profile_id, course_id, lesson_id, date, session_count, characters_typed, error_count, elapsed_time, min_speed, max_speed FROM training_stats_rollups "
+                                   "WHERE period = ? AND date < ? ORDER BY id LIMIT ?"))
+    {
+        qWarning() <<  selectQuery.lastError().text();
+        raiseError(selectQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    selectQuery.bindValue(0, DailyRollup);
+    selectQuery.bindValue(1, dailyCutoff);
+    selectQuery.bindValue(2, RollUpBatchSize);
+
+    if (!selectQuery.exec())
+    {
+        qWarning() <<  selectQuery.lastError().text();
+        raiseError(selectQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    QList<QVariantList> dailyTotals;
+
+    while (selectQuery.next())
+    {
+        QVariantList values;
+
+        for (int i = 0; i < 11; i++)
+        {
+            values.append(selectQuery.value(i));
+        }
+
+        dailyTotals.append(values);
+    }
+
+    selectQuery.finish();
+
+    if (dailyTotals.isEmpty())
+    {
+        db.rollback();
+        return true;
+    }
+
+    QSqlQuery addRollupQuery(db);
+    QSqlQuery updateRollupQuery(db);
+    QSqlQuery removeRollupQuery(db);
+
+    if (!prepareQuery(addRollupQuery, "INSERT OR IGNORE INTO training_stats_rollups (profile_id, course_id, lesson_id, period, date, session_count, characters_typed, error_count, elapsed_time, min_speed, max_speed) VALUES (?, ?, ?, ?, ?, 0, 0, 0, 0, 2147483647, 0)"))
+    {
+        qWarning() <<  addRollupQuery.lastError().text();
+        raiseError(addRollupQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    if (!prepareQuery(updateRollupQuery, "UPDATE training_stats_rollups SET session_count = session_count + ?, characters_typed = characters_typed + ?, error_count = error_count + ?, elapsed_time = elapsed_time + ?, min_speed = MIN(min_speed, ?), max_speed = MAX(max_speed, ?) "
+                                         "WHERE profile_id = ? AND course_id = ? AND lesson_id = ? AND period = ? AND date = ?"))
+    {
+        qWarning() <<  updateRollupQuery.lastError().text();
+        raiseError(updateRollupQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    if (!prepareQuery(removeRollupQuery, "DELETE FROM training_stats_rollups WHERE id = ?"))
+    {
+        qWarning() <<  removeRollupQuery.lastError().text();
+        raiseError(removeRollupQuery.lastError());
+        db.rollback();
+        return false;
+    }
+
+    foreach (const QVariantList& values, dailyTotals)
+    {
+        const qint64 date = periodStart(values.at(4).toLongLong(), WeeklyRollup);
+
+        addRollupQuery.bindValue(0, values.at(1));
+        addRollupQuery.bindValue(1, values.at(2));
+        addRollupQuery.bindValue(2, values.at(3));
+        addRollupQuery.bindValue(3, WeeklyRollup);
+        addRollupQuery.bindValue(4, date);
+
+        if (!addRollupQuery.exec())
+        {
+            qWarning() <<  addRollupQuery.lastError().text();
+            raiseError(addRollupQuery.lastError());
+            db.rollback();
+            return false;
+        }
+
+        for (int i = 0; i < 6; i++)
+        {
+            updateRollupQuery.bindValue(i, values.at(5 + i));
+        }
+
+        updateRollupQuery.bindValue(6, values.at(1));
+        updateRollupQuery.bindValue(7, values.at(2));
+        updateRollupQuery.bindValue(8, values.at(3));
+        updateRollupQuery.bindValue(9, WeeklyRollup);
+        updateRollupQuery.bindValue(10, date);
+
+        if (!updateRollupQuery.exec())
+        {
+            qWarning() <<  updateRollupQuery.lastError().text();
+            raiseError(updateRollupQuery.lastError());
+            db.rollback();
+            return false;
+        }
+
+        removeRollupQuery.bindValue(0, values.at(0));
+
+        if (!removeRollupQuery.exec())
+        {
+            qWarning() <<  removeRollupQuery.lastError().text();
+            raiseError(removeRollupQuery.lastError());
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (!db.commit())
+    {
+        qWarning() <<  db.lastError().text();
+        raiseError(db.lastError());
+        db.rollback();
+        return false;
+    }
+
+    m_hasWritten = true;
+    *count = dailyTotals.count();
+
+    return true;
+}
@@ -0,0 +1,103 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TRAININGSTATSWRITER_H
+#define TRAININGSTATSWRITER_H
+
+#include "core/dbaccess.h"
+
+#include <QByteArray>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+
+#include "core/errorhistogram.h"
+
+class QThread;
+class QTimer;
+class TrainingStats;
+
+/**
+ * The results of a finished lesson, copied from a TrainingStats instance so
+ * they can be handed over to the writer thread.
+ */
+struct TrainingStatsRecord
+{
+    int profileId;
+    QString courseId;
+    QString lessonId;
+    qint64 date;
+    int charactersTyped;
+    int errorCount;
+    int elapsedTime;
+    ErrorHistogram errorHistogram;
+    QByteArray keystrokes;
+};
+
+/**
+ * Saves training results in a thread of its own.
+ *
+ * Records are put into a queue and written in batches, one transaction per
+ * batch, so the GUI never waits for the disk. A batch which can't be written
+ * goes back to the head of the queue and is retried later, waiting longer
+ * after every failed attempt.
+ *
+ * Once the writer has been idle for a while it checkpoints the write-ahead
+ * log into the database, and on shutdown it truncates the log.
+ *
+ * In the background the writer also merges old sessions into daily and,
+ * later, weekly totals in training_stats_rollups, a limited number of rows
+ * at a time. The latest session of every lesson is always kept.
+ */
+class TrainingStatsWriter : public DbAccess
+{
+    Q_OBJECT
+public:
+    TrainingStatsWriter();
+    ~TrainingStatsWriter();
+    void enqueue(const TrainingStatsRecord& record);
+    void shutdown();
+
+signals:
+    void recordsSaved();
+    void recordsNotSaved(const QString& errorMessage);
+
+private slots:
+    void flush();
+    void checkpoint();
+    void rollUp();
+    void closeConnection();
+
+private:
+    bool writeRecords(const QList<TrainingStatsRecord>& records);
+    bool rollUpSessions(qint64 detailedCutoff, qint64 dailyCutoff, int* count);
+    bool rollUpDailyTotals(qint64 dailyCutoff, int* count);
+    QThread* m_thread;
+    QTimer* m_checkpointTimer;
+    QTimer* m_rollUpTimer;
+    QTimer* m_retryTimer;
+    QMutex m_mutex;
+    QQueue<TrainingStatsRecord> m_queue;
+    int m_retryInterval;
+    bool m_flushScheduled;
+    bool m_queueOverflowed;
+    bool m_hasWritten;
+    bool m_hasRolledUp;
+};
+
+#endif // TRAININGSTATSWRITER_H
@@ -28,6 +28,7 @@
 #include "core/dataindex.h"
 #include "core/course.h"
 #include "core/lesson.h"
+#include "core/lessontextprovider.h"
 #include "core/keyboardlayout.h"
 #include "core/key.h"
 #include "core/keychar.h"
@@ -39,6 +40,24 @@ enum KeyTypeId
     SpecialKeyId
 };
 
+class UserLessonTextProvider : public LessonTextProvider
+{
+public:
+    explicit UserLessonTextProvider(const QString& courseId) :
+        m_courseId(courseId)
+    {
+    }
+
+    QString lessonText(const QString& key) Q_DECL_OVERRIDE
+    {
+        UserDataAccess userDataAccess;
+        return userDataAccess.loadLessonText(m_courseId, key);
+    }
+
+private:
+    QString m_courseId;
+};
+
 UserDataAccess::UserDataAccess(QObject* parent) :
     DbAccess(parent)
 {
@@ -108,7 +127,7 @@ bool UserDataAccess::loadCourse(const QString& id, Course* target)
 
     QSqlQuery courseQuery(db);
 
-    courseQuery.prepare("SELECT title, description, keyboard_layout_name FROM courses WHERE id = ? LIMIT 1");
+    prepareQuery(courseQuery, "SELECT title, description, keyboard_layout_name FROM courses WHERE id = ? LIMIT 1");
     courseQuery.bindValue(0, id);
     courseQuery.exec();
 
@@ -131,10 +150,12 @@ bool UserDataAccess::loadCourse(const QString& id, Course* target)
     target->setDescription(courseQuery.value(1).toString());
     target->setKeyboardLayoutName(courseQuery.value(2).toString());
     target->clearLessons();
+    courseQuery.finish();
 
     QSqlQuery lessonsQuery(db);
 
-    lessonsQuery.prepare("SELECT id, title, new_characters, text FROM course_lessons WHERE course_id = ?");
+    // the texts are only fetched once a lesson is opened
+    prepareQuery(lessonsQuery, "SELECT id, title, new_characters FROM course_lessons WHERE course_id = ?");
     lessonsQuery.bindValue(0, id);
     lessonsQuery.exec();
 
@@ -145,6 +166,8 @@ bool UserDataAccess::loadCourse(const QString& id, Course* target)
         return false;
     }
 
+    const QSharedPointer<LessonTextProvider> textProvider(new UserLessonTextProvider(id));
+
     while (lessonsQuery.next())
     {
         Lesson* lesson = new Lesson();
@@ -152,16 +175,57 @@ bool UserDataAccess::loadCourse(const QString& id, Course* target)
         lesson->setId(lessonsQuery.value(0).toString());
         lesson->setTitle(lessonsQuery.value(1).toString());
         lesson->setNewCharacters(lessonsQuery.value(2).toString());
-        lesson->setText(lessonsQuery.value(3).toString());
+        lesson->setTextProvider(textProvider, lesson->id());
 
         target->addLesson(lesson);
     }
 
+    target->startChangeTracking();
     target->setIsValid(true);
 
     return true;
 }
 
+QString UserDataAccess::loadLessonText(const QString& courseId, const QString& lessonId)
+{
+    QSqlDatabase db = database();
+
+    if (!db.isOpen())
+        return QString();
+
+    QSqlQuery lessonTextQuery(db);
+
+    prepareQuery(lessonTextQuery, "SELECT text FROM course_lessons WHERE course_id = ? AND id = ? LIMIT 1");
+    lessonTextQuery.bindValue(0, courseId);
+    lessonTextQuery.bindValue(1, lessonId);
+    lessonTextQuery.exec();
+
+    if (lessonTextQuery.lastError().isValid())
+    {
+        qWarning() << lessonTextQuery.lastError().text();
+        raiseError(lessonTextQuery.lastError());
+        lessonTextQuery.finish();
+        return QString();
+    }
+
+    if (!lessonTextQuery.next())
+    {
+        const QString warning = i18n("No lesson with ID %1", lessonId);
+        qWarning() << warning;
+        raiseError(warning);
+        lessonTextQuery.finish();
+        return QString();
+    }
+
+    const QString text = lessonTextQuery.value(0).toString();
+
+    // the statement is cached, left active it would keep the read
+    // transaction open
+    lessonTextQuery.finish();
+
+    return text;
+}
+
 bool UserDataAccess::storeCourse(Course* course)
 {
     QSqlDatabase db = database();
@@ -176,58 +240,153 @@ bool UserDataAccess::storeCourse(Course* course)
         return false;
     }
 
-    QSqlQuery cleanUpCourseQuery(db);
+    bool rewriteAllLessons = !course->isTrackingChanges();
+    int rewriteFrom = 0;
 
-    cleanUpCourseQuery.prepare("DELETE FROM courses WHERE id = ?");
-    cleanUpCourseQuery.bindValue(0, course->id());
-    cleanUpCourseQuery.exec();
-
-    if (cleanUpCourseQuery.lastError().isValid())
+    if (!course->isTrackingChanges() || course->isModified())
     {
-        qWarning() << cleanUpCourseQuery.lastError().text();
-        raiseError(cleanUpCourseQuery.lastError());
-        db.rollback();
-        return false;
+        QSqlQuery storeCourseQuery(db);
+
+        prepareQuery(storeCourseQuery, "INSERT OR REPLACE INTO courses (id, title, description, keyboard_layout_name) VALUES (?, ?, ?, ?)");
+        storeCourseQuery.bindValue(0, course->id());
+        storeCourseQuery.bindValue(1, course->title());
+        storeCourseQuery.bindValue(2, course->description());
+        storeCourseQuery.bindValue(3, course->keyboardLayoutName());
+        storeCourseQuery.exec();
+
+        if (storeCourseQuery.lastError().isValid())
+        {
+            qWarning() << storeCourseQuery.lastError().text();
+            raiseError(storeCourseQuery.lastError());
+            db.rollback();
+            return false;
+        }
     }
 
-    QSqlQuery cleanUpLessonsQuery(db);
+    if (!rewriteAllLessons)
+    {
+        // lessons are read back in the order they have been inserted, so
+        // everything from the first added or moved lesson on is written anew,
+        // only the modified lessons in front of it are updated in place
+
+        rewriteFrom = course->firstMovedLessonIndex();
+
+        QSqlQuery updateLessonQuery(db);
+        QSqlQuery updateLessonAttributesQuery(db);
 
-    cleanUpLessonsQuery.prepare("DELETE FROM course_lessons WHERE course_id = ?");
-    cleanUpLessonsQuery.bindValue(0, course->id());
-    cleanUpLessonsQuery.exec();
+        prepareQuery(updateLessonQuery, "UPDATE course_lessons SET title = ?, new_characters = ?, text = ? WHERE id = ? AND course_id = ?");
+        updateLessonQuery.bindValue(4, course->id());
+
+        // a text which hasn't been fetched can't have been changed, it stays
+        // in the database as it is
+        prepareQuery(updateLessonAttributesQuery, "UPDATE course_lessons SET title = ?, new_characters = ? WHERE id = ? AND course_id = ?");
+        updateLessonAttributesQuery.bindValue(3, course->id());
+
+        for (int i = 0; i < rewriteFrom; i++)
+        {
+            Lesson* const lesson = course->lesson(i);
+
+            if (!lesson->isModified())
+                continue;
+
+            QSqlQuery& query = lesson->isTextLoaded()? updateLessonQuery: updateLessonAttributesQuery;
+
+            query.bindValue(0, lesson->title());
+            query.bindValue(1, lesson->newCharacters());
+
+            if (lesson->isTextLoaded())
+            {
+                query.bindValue(2, lesson->text());
+                query.bindValue(3, lesson->id());
+            }
+            else
+            {
+                query.bindValue(2, lesson->id());
+            }
+
+            query.exec();
+
+            if (query.lastError().isValid())
+            {
+                qWarning() << query.lastError().text();
+                raiseError(query.lastError());
+                db.rollback();
+                return false;
+            }
 
-    if (cleanUpLessonsQuery.lastError().isValid())
+            if (query.numRowsAffected() == 0)
+            {
+                // the lesson has got a new ID, the old row can't be found anymore
+                rewriteAllLessons = true;
+                break;
+            }
+        }
+    }
+
+    if (rewriteAllLessons)
     {
-        qWarning() << cleanUpLessonsQuery.lastError().text();
-        raiseError(cleanUpLessonsQuery.lastError());
-        db.rollback();
-        return false;
+        rewriteFrom = 0;
     }
 
-    QSqlQuery insertCourseQuery(db);
+    // only the texts of the lessons written anew have to be fetched, before
+    // their rows are deleted
+    for (int i = rewriteFrom; i < course->lessonCount(); i++)
+    {
+        course->lesson(i)->text();
+    }
+
+    if (rewriteAllLessons)
+    {
+        QSqlQuery cleanUpLessonsQuery(db);
 
-    insertCourseQuery.prepare("INSERT INTO courses (id, title, description, keyboard_layout_name) VALUES (?, ?, ?, ?)");
-    insertCourseQuery.bindValue(0, course->id());
-    insertCourseQuery.bindValue(1, course->title());
-    insertCourseQuery.bindValue(2, course->description());
-    insertCourseQuery.bindValue(3, course->keyboardLayoutName());
-    insertCourseQuery.exec();
+        prepareQuery(cleanUpLessonsQuery, "DELETE FROM course_lessons WHERE course_id = ?");
+        cleanUpLessonsQuery.bindValue(0, course->id());
+        cleanUpLessonsQuery.exec();
 
-    if (insertCourseQuery.lastError().isValid())
+        if (cleanUpLessonsQuery.lastError().isValid())
+        {
+            qWarning() << cleanUpLessonsQuery.lastError().text();
+            raiseError(cleanUpLessonsQuery.lastError());
+            db.rollback();
+            return false;
+        }
+    }
+    else
     {
-        qWarning() << insertCourseQuery.lastError().text();
-        raiseError(insertCourseQuery.lastError());
-        db.rollback();
-        return false;
+        QStringList obsoleteLessonIds = course->removedLessonIds();
+
+        for (int i = rewriteFrom; i < course->lessonCount(); i++)
+        {
+            obsoleteLessonIds.append(course->lesson(i)->id());
+        }
+
+        QSqlQuery deleteLessonQuery(db);
+
+        prepareQuery(deleteLessonQuery, "DELETE FROM course_lessons WHERE id = ? AND course_id = ?");
+        deleteLessonQuery.bindValue(1, course->id());
+
+        foreach (const QString& lessonId, obsoleteLessonIds)
+        {
+            deleteLessonQuery.bindValue(0, lessonId);
+            deleteLessonQuery.exec();
+
+            if (deleteLessonQuery.lastError().isValid())
+            {
+                qWarning() << deleteLessonQuery.lastError().text();
+                raiseError(deleteLessonQuery.lastError());
+                db.rollback();
+                return false;
+            }
+        }
     }
 
     QSqlQuery insertLessonsQuery(db);
 
-    insertLessonsQuery.prepare("INSERT INTO course_lessons (id, title, new_characters, text, course_id) VALUES(?, ?, ?, ?, ?)");
+    prepareQuery(insertLessonsQuery, "INSERT INTO course_lessons (id, title, new_characters, text, course_id) VALUES(?, ?, ?, ?, ?)");
 
     insertLessonsQuery.bindValue(4, course->id());
 
-    for (int i = 0; i < course->lessonCount(); i++)
+    for (int i = rewriteFrom; i < course->lessonCount(); i++)
     {
         Lesson* lesson = course->lesson(i);
 
@@ -254,6 +413,8 @@ bool UserDataAccess::storeCourse(Course* course)
         return false;
     }
 
+    course->startChangeTracking();
+
     return true;
 }
 
@@ -273,7 +434,7 @@ bool UserDataAccess::deleteCourse(Course* course)
 
     QSqlQuery deleteCourseQuery(db);
 
-    deleteCourseQuery.prepare("DELETE FROM courses WHERE id = ?");
+    prepareQuery(deleteCourseQuery, "DELETE FROM courses WHERE id = ?");
     deleteCourseQuery.bindValue(0, course->id());
     deleteCourseQuery.exec();
 
@@ -287,7 +448,7 @@ bool UserDataAccess::deleteCourse(Course* course)
 
     QSqlQuery deleteLessonsQuery(db);
 
-    deleteLessonsQuery.prepare("DELETE FROM course_lessons WHERE course_id = ?");
+    prepareQuery(deleteLessonsQuery, "DELETE FROM course_lessons WHERE course_id = ?");
     deleteLessonsQuery.bindValue(0, course->id());
     deleteLessonsQuery.exec();
 
@@ -321,7 +482,7 @@ bool UserDataAccess::loadKeyboardLayout(const QString& id, KeyboardLayout* targe
 
     QSqlQuery keyboardLayoutQuery(db);
 
-    keyboardLayoutQuery.prepare("SELECT title, name, width, height FROM keyboard_layouts WHERE id = ? LIMIT 1");
+    prepareQuery(keyboardLayoutQuery, "SELECT title, name, width, height FROM keyboard_layouts WHERE id = ? LIMIT 1");
     keyboardLayoutQuery.bindValue(0, id);
     keyboardLayoutQuery.exec();
 
@@ -346,17 +507,22 @@ bool UserDataAccess::loadKeyboardLayout(const QString& id, KeyboardLayout* targe
     target->setWidth(keyboardLayoutQuery.value(2).toInt());
     target->setHeight(keyboardLayoutQuery.value(3).toInt());
     target->clearKeys();
+    keyboardLayoutQuery.finish();
+
+    // the keys and their characters in one pass, each key comes with one
+    // row per character, special keys and keys without characters with a
+    // single row of NULL characters
 
     QSqlQuery keysQuery(db);
 
-    keysQuery.prepare("SELECT id, left, top, width, height, type, finger_index, has_haptic_marker, special_key_type, modifier_id, label FROM keyboard_layout_keys WHERE keyboard_layout_id = ?");
+    prepareQuery(keysQuery,
+                 "SELECT k.id, k.left, k.top, k.width, k.height, k.type, k.finger_index, k.has_haptic_marker, k.special_key_type, k.modifier_id, k.label, c.position, c.character, c.modifier "
+                 "FROM keyboard_layout_keys k LEFT JOIN keyboard_layout_key_chars c ON c.key_id = k.id "
+                 "WHERE k.keyboard_layout_id = ? "
+                 "ORDER BY k.id, c.id");
     keysQuery.bindValue(0, id);
     keysQuery.exec();
 
-    QSqlQuery keyCharsQuery(db);
-
-    keyCharsQuery.prepare("SELECT position, character, modifier FROM keyboard_layout_key_chars WHERE key_id = ?");
-
     if (keysQuery.lastError().isValid())
     {
         qWarning() << keysQuery.lastError().text();
@@ -364,61 +530,78 @@ bool UserDataAccess::loadKeyboardLayout(const QString& id, KeyboardLayout* targe
         return false;
     }
 
+    // keys are only added to the layout once all of their characters have
+    // been read, like they were when every key had a query of its own
+
+    int currentKeyId = -1;
+    AbstractKey* pendingKey = 0;
+    Key* currentKey = 0;
+
     while (keysQuery.next())
     {
-        AbstractKey* abstractKey;
-
-        KeyTypeId keyType =  static_cast<KeyTypeId>(keysQuery.value(5).toInt());
+        const int keyId = keysQuery.value(0).toInt();
 
-        if (keyType == KeyId)
+        if (keyId != currentKeyId)
         {
-            Key* key = new Key();
+            if (pendingKey)
+            {
+                target->addKey(pendingKey);
+            }
 
-            key->setFingerIndex(keysQuery.value(6).toInt());
-            key->setHasHapticMarker(keysQuery.value(7).toBool());
+            AbstractKey* abstractKey;
 
-            keyCharsQuery.bindValue(0, keysQuery.value(0));
-            keyCharsQuery.exec();
+            KeyTypeId keyType =  static_cast<KeyTypeId>(keysQuery.value(5).toInt());
 
-            if (keyCharsQuery.lastError().isValid())
+            if (keyType == KeyId)
             {
-                qWarning() << keyCharsQuery.lastError().text();
-                raiseError(keyCharsQuery.lastError());
-                return false;
-            }
+                Key* key = new Key();
+
+                key->setFingerIndex(keysQuery.value(6).toInt());
+                key->setHasHapticMarker(keysQuery.value(7).toBool());
 
-            while (keyCharsQuery.next())
+                abstractKey = key;
+                currentKey = key;
+            }
+            else
             {
-                KeyChar* keyChar = new KeyChar();
+                SpecialKey* specialKey = new SpecialKey();
 
-                keyChar->setPosition(static_cast<KeyChar::Position>(keyCharsQuery.value(0).toInt()));
-                keyChar->setValue(keyCharsQuery.value(1).toString().at(0));
-                keyChar->setModifier(keyCharsQuery.value(2).toString());
+                specialKey->setTypeStr(keysQuery.value(8).toString());
+                specialKey->setModifierId(keysQuery.value(9).toString());
+                specialKey->setLabel(keysQuery.value(10).toString());
 
-                key->addKeyChar(keyChar);
+                abstractKey = specialKey;
+                currentKey = 0;
             }
 
-            abstractKey = key;
+            abstractKey->setLeft(keysQuery.value(1).toInt());
+            abstractKey->setTop(keysQuery.value(2).toInt());
+            abstractKey->setWidth(keysQuery.value(3).toInt());
+            abstractKey->setHeight(keysQuery.value(4).toInt());
+            abstractKey->setStorageId(keyId);
+
+            pendingKey = abstractKey;
+            currentKeyId = keyId;
         }
-        else
+
+        if (currentKey && !keysQuery.isNull(11))
         {
-            SpecialKey* specialKey = new SpecialKey();
+            KeyChar* keyChar = new KeyChar();
 
-            specialKey->setTypeStr(keysQuery.value(8).toString());
-            specialKey->setModifierId(keysQuery.value(9).toString());
-            specialKey->setLabel(keysQuery.value(10).toString());
+            keyChar->setPosition(static_cast<KeyChar::Position>(keysQuery.value(11).toInt()));
+            keyChar->setValue(keysQuery.value(12).toString().at(0));
+            keyChar->setModifier(keysQuery.value(13).toString());
 
-            abstractKey = specialKey;
+            currentKey->addKeyChar(keyChar);
         }
+    }
 
-        abstractKey->setLeft(keysQuery.value(1).toInt());
-        abstractKey->setTop(keysQuery.value(2).toInt());
-        abstractKey->setWidth(keysQuery.value(3).toInt());
-        abstractKey->setHeight(keysQuery.value(4).toInt());
-
-        target->addKey(abstractKey);
+    if (pendingKey)
+    {
+        target->addKey(pendingKey);
     }
 
+    target->startChangeTracking();
     target->setIsValid(true);
 
     return true;
@@ -438,82 +621,230 @@ bool UserDataAccess::storeKeyboardLayout(KeyboardLayout* keyboardLayout)
         return false;
     }
 
-    QSqlQuery cleanUpKeyCharsQuery(db);
-
-    cleanUpKeyCharsQuery.prepare("DELETE FROM keyboard_layout_key_chars WHERE key_id IN (SELECT id FROM keyboard_layout_keys WHERE keyboard_layout_id = ?)");
-    cleanUpKeyCharsQuery.bindValue(0, keyboardLayout->id());
-    cleanUpKeyCharsQuery.exec();
+    bool rewriteAllKeys = !keyboardLayout->isTrackingChanges();
+    int rewriteFrom = 0;
 
-    if (cleanUpKeyCharsQuery.lastError().isValid())
+    if (!keyboardLayout->isTrackingChanges() || keyboardLayout->isModified())
     {
-        qWarning() << cleanUpKeyCharsQuery.lastError().text();
-        raiseError(cleanUpKeyCharsQuery.lastError());
-        db.rollback();
-        return false;
-    }
+        QSqlQuery storeKeyboardLayoutQuery(db);
+
+        prepareQuery(storeKeyboardLayoutQuery, "INSERT OR REPLACE INTO keyboard_layouts (id, title, name, width, height) VALUES (?, ?, ?, ?, ?)");
+        storeKeyboardLayoutQuery.bindValue(0, keyboardLayout->id());
+        storeKeyboardLayoutQuery.bindValue(1, keyboardLayout->title());
+        storeKeyboardLayoutQuery.bindValue(2, keyboardLayout->name());
+        storeKeyboardLayoutQuery.bindValue(3, keyboardLayout->width());
+        storeKeyboardLayoutQuery.bindValue(4, keyboardLayout->height());
+        storeKeyboardLayoutQuery.exec();
 
+        if (storeKeyboardLayoutQuery.lastError().isValid())
+        {
+            qWarning() << storeKeyboardLayoutQuery.lastError().text();
+            raiseError(storeKeyboardLayoutQuery.lastError());
+            db.rollback();
+            return false;
+        }
+    }
 
-    QSqlQuery cleanUpKeysQuery(db);
+    QSqlQuery insertKeyCharQuery(db);
 
-    cleanUpKeysQuery.prepare("DELETE FROM keyboard_layout_keys WHERE keyboard_layout_id = ?");
-    cleanUpKeysQuery.bindValue(0, keyboardLayout->id());
-    cleanUpKeysQuery.exec();
+    prepareQuery(insertKeyCharQuery, "INSERT INTO keyboard_layout_key_chars (key_id, position, character, modifier) VALUES (?, ?, ?, ?)");
 
-    if (cleanUpKeysQuery.lastError().isValid())
+    if (!rewriteAllKeys)
     {
-        qWarning() << cleanUpKeysQuery.lastError().text();
-        raiseError(cleanUpKeysQuery.lastError());
-        db.rollback();
-        return false;
-    }
+        // keys are read back in the order they have been inserted, so
+        // everything from the first added or moved key on is written anew,
+        // only the modified keys in front of it are updated in place
 
-    QSqlQuery cleanUpKeyboardLayoutQuery(db);
+        rewriteFrom = keyboardLayout->firstMovedKeyIndex();
 
-    cleanUpKeyboardLayoutQuery.prepare("DELETE FROM keyboard_layouts WHERE id = ?");
-    cleanUpKeyboardLayoutQuery.bindValue(0, keyboardLayout->id());
-    cleanUpKeyboardLayoutQuery.exec();
+        QSqlQuery updateKeyQuery(db);
+        QSqlQuery updateSpecialKeyQuery(db);
+        QSqlQuery cleanUpKeyCharsQuery(db);
 
-    if (cleanUpKeyboardLayoutQuery.lastError().isValid())
-    {
-        qWarning() << cleanUpKeyboardLayoutQuery.lastError().text();
-        raiseError(cleanUpKeyboardLayoutQuery.lastError());
-        db.rollback();
-        return false;
+        prepareQuery(updateKeyQuery, "UPDATE keyboard_layout_keys SET left = ?, top = ?, width = ?, height = ?, finger_index = ?, has_haptic_marker = ? WHERE id = ? AND keyboard_layout_id = ?");
+        updateKeyQuery.bindValue(7, keyboardLayout->id());
+        prepareQuery(updateSpecialKeyQuery, "UPDATE keyboard_layout_keys SET left = ?, top = ?, width = ?, height = ?, special_key_type = ?, modifier_id = ?, label = ? WHERE id = ? AND keyboard_layout_id = ?");
+        updateSpecialKeyQuery.bindValue(8, keyboardLayout->id());
+        prepareQuery(cleanUpKeyCharsQuery, "DELETE FROM keyboard_layout_key_chars WHERE key_id = ?");
+
+        for (int i = 0; i < rewriteFrom; i++)
+        {
+            AbstractKey* const abstractKey = keyboardLayout->key(i);
+
+            if (!abstractKey->isModified())
+                continue;
+
+            if (abstractKey->storageId() == -1)
+            {
+                rewriteAllKeys = true;
+                break;
+            }
+
+            if (Key* const key = qobject_cast<Key*>(abstractKey))
+            {
+                updateKeyQuery.bindValue(0, key->left());
+                updateKeyQuery.bindValue(1, key->top());
+                updateKeyQuery.bindValue(2, key->width());
+                updateKeyQuery.bindValue(3, key->height());
+                updateKeyQuery.bindValue(4, key->fingerIndex());
+                updateKeyQuery.bindValue(5, key->hasHapticMarker());
+                updateKeyQuery.bindValue(6, key->storageId());
+                updateKeyQuery.exec();
+
+                if (updateKeyQuery.lastError().isValid())
+                {
+                    qWarning() << updateKeyQuery.lastError().text();
+                    raiseError(updateKeyQuery.lastError());
+                    db.rollback();
+                    return false;
+                }
+
+                if (updateKeyQuery.numRowsAffected() == 0)
+                {
+                    rewriteAllKeys = true;
+                    break;
+                }
+
+                cleanUpKeyCharsQuery.bindValue(0, key->storageId());
+                cleanUpKeyCharsQuery.exec();
+
+                if (cleanUpKeyCharsQuery.lastError().isValid())
+                {
+                    qWarning() << cleanUpKeyCharsQuery.lastError().text();
+                    raiseError(cleanUpKeyCharsQuery.lastError());
+                    db.rollback();
+                    return false;
+                }
+
+                if (!insertKeyChars(insertKeyCharQuery, key, key->storageId()))
+                {
+                    db.rollback();
+                    return false;
+                }
+            }
+
+            if (SpecialKey* const specialKey = qobject_cast<SpecialKey*>(abstractKey))
+            {
+                updateSpecialKeyQuery.bindValue(0, specialKey->left());
+                updateSpecialKeyQuery.bindValue(1, specialKey->top());
+                updateSpecialKeyQuery.bindValue(2, specialKey->width());
+                updateSpecialKeyQuery.bindValue(3, specialKey->height());
+                updateSpecialKeyQuery.bindValue(4, specialKey->typeStr());
+                updateSpecialKeyQuery.bindValue(5, specialKey->modifierId());
+                updateSpecialKeyQuery.bindValue(6, specialKey->label());
+                updateSpecialKeyQuery.bindValue(7, specialKey->storageId());
+                updateSpecialKeyQuery.exec();
+
+                if (updateSpecialKeyQuery.lastError().isValid())
+                {
+                    qWarning() << updateSpecialKeyQuery.lastError().text();
+                    raiseError(updateSpecialKeyQuery.lastError());
+                    db.rollback();
+                    return false;
+                }
+
+                if (updateSpecialKeyQuery.numRowsAffected() == 0)
+                {
+                    rewriteAllKeys = true;
+                    break;
+                }
+            }
+        }
     }
 
-    QSqlQuery insertKeyboardLayoutQuery(db);
+    if (rewriteAllKeys)
+    {
+        rewriteFrom = 0;
+
+        QSqlQuery cleanUpKeyCharsQuery(db);
+
+        prepareQuery(cleanUpKeyCharsQuery, "DELETE FROM keyboard_layout_key_chars WHERE key_id IN (SELECT id FROM keyboard_layout_keys WHERE keyboard_layout_id = ?)");
+        cleanUpKeyCharsQuery.bindValue(0, keyboardLayout->id());
+        cleanUpKeyCharsQuery.exec();
+
+        if (cleanUpKeyCharsQuery.lastError().isValid())
+        {
+            qWarning() << cleanUpKeyCharsQuery.lastError().text();
+            raiseError(cleanUpKeyCharsQuery.lastError());
+            db.rollback();
+            return false;
+        }
 
-    insertKeyboardLayoutQuery.prepare("INSERT INTO keyboard_layouts (id, title, name, width, height) VALUES (?, ?, ?, ?, ?)");
-    insertKeyboardLayoutQuery.bindValue(0, keyboardLayout->id());
-    insertKeyboardLayoutQuery.bindValue(1, keyboardLayout->title());
-    insertKeyboardLayoutQuery.bindValue(2, keyboardLayout->name());
-    insertKeyboardLayoutQuery.bindValue(3, keyboardLayout->width());
-    insertKeyboardLayoutQuery.bindValue(4, keyboardLayout->height());
-    insertKeyboardLayoutQuery.exec();
+        QSqlQuery cleanUpKeysQuery(db);
 
-    if (insertKeyboardLayoutQuery.lastError().isValid())
+        prepareQuery(cleanUpKeysQuery, "DELETE FROM keyboard_layout_keys WHERE keyboard_layout_id = ?");
+        cleanUpKeysQuery.bindValue(0, keyboardLayout->id());
+        cleanUpKeysQuery.exec();
+
+        if (cleanUpKeysQuery.lastError().isValid())
+        {
+            qWarning() << cleanUpKeysQuery.lastError().text();
+            raiseError(cleanUpKeysQuery.lastError());
+            db.rollback();
+            return false;
+        }
+    }
+    else
     {
-        qWarning() << insertKeyboardLayoutQuery.lastError().text();
-        raiseError(insertKeyboardLayoutQuery.lastError());
-        db.rollback();
-        return false;
+        QList<int> obsoleteKeyIds = keyboardLayout->removedKeyStorageIds();
+
+        for (int i = rewriteFrom; i < keyboardLayout->keyCount(); i++)
+        {
+            const int storageId = keyboardLayout->key(i)->storageId();
+
+            if (storageId != -1)
+                obsoleteKeyIds.append(storageId);
+        }
+
+        QSqlQuery deleteKeyCharsQuery(db);
+        QSqlQuery deleteKeyQuery(db);
+
+        prepareQuery(deleteKeyCharsQuery, "DELETE FROM keyboard_layout_key_chars WHERE key_id = ?");
+        prepareQuery(deleteKeyQuery, "DELETE FROM keyboard_layout_keys WHERE id = ? AND keyboard_layout_id = ?");
+        deleteKeyQuery.bindValue(1, keyboardLayout->id());
+
+        foreach (int keyId, obsoleteKeyIds)
+        {
+            deleteKeyCharsQuery.bindValue(0, keyId);
+            deleteKeyCharsQuery.exec();
+
+            if (deleteKeyCharsQuery.lastError().isValid())
+            {
+                qWarning() << deleteKeyCharsQuery.lastError().text();
+                raiseError(deleteKeyCharsQuery.lastError());
+                db.rollback();
+                return false;
+            }
+
+            deleteKeyQuery.bindValue(0, keyId);
+            deleteKeyQuery.exec();
+
+            if (deleteKeyQuery.lastError().isValid())
+            {
+                qWarning() << deleteKeyQuery.lastError().text();
+                raiseError(deleteKeyQuery.lastError());
+                db.rollback();
+                return false;
+            }
+        }
     }
 
     QSqlQuery insertKeyQuery(db);
     QSqlQuery insertSpecialKeyQuery(db);
-    QSqlQuery insertKeyCharQuery(db);
-    QSqlQuery idQuery(db);
 
-    insertKeyQuery.prepare("INSERT INTO keyboard_layout_keys (keyboard_layout_id, left, top, width, height, type, finger_index, has_haptic_marker) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    prepareQuery(insertKeyQuery, "INSERT INTO keyboard_layout_keys (keyboard_layout_id, left, top, width, height, type, finger_index, has_haptic_marker) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
     insertKeyQuery.bindValue(0, keyboardLayout->id());
     insertKeyQuery.bindValue(5, KeyId);
-    insertSpecialKeyQuery.prepare("INSERT INTO keyboard_layout_keys (keyboard_layout_id, left, top, width, height, type, special_key_type, modifier_id, label) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    prepareQuery(insertSpecialKeyQuery, "INSERT INTO keyboard_layout_keys (keyboard_layout_id, left, top, width, height, type, special_key_type, modifier_id, label) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
     insertSpecialKeyQuery.bindValue(0, keyboardLayout->id());
     insertSpecialKeyQuery.bindValue(5, SpecialKeyId);
-    insertKeyCharQuery.prepare("INSERT INTO keyboard_layout_key_chars (key_id, position, character, modifier) VALUES (?, ?, ?, ?)");
-    idQuery.prepare("SELECT last_insert_rowid()");
 
-    for (int i = 0; i < keyboardLayout->keyCount(); i++)
+    // the row IDs of the new keys, only handed to the keys once the
+    // transaction has been committed
+
+    QList<int> keyIds;
+
+    for (int i = rewriteFrom; i < keyboardLayout->keyCount(); i++)
     {
         AbstractKey* const abstractKey = keyboardLayout->key(i);
 
@@ -535,39 +866,15 @@ bool UserDataAccess::storeKeyboardLayout(KeyboardLayout* keyboardLayout)
                 return false;
             }
 
-            idQuery.exec();
+            const int keyId = insertKeyQuery.lastInsertId().toInt();
 
-            if (idQuery.lastError().isValid())
+            if (!insertKeyChars(insertKeyCharQuery, key, keyId))
             {
-                qWarning() << idQuery.lastError().text();
-                raiseError(idQuery.lastError());
                 db.rollback();
                 return false;
             }
 
-            idQuery.next();
-
-            const int keyId = idQuery.value(0).toInt();
-
-            insertKeyCharQuery.bindValue(0, keyId);
-
-            for (int j = 0; j < key->keyCharCount(); j++)
-            {
-                KeyChar * const keyChar = key->keyChar(j);
-
-                insertKeyCharQuery.bindValue(1, keyChar->position());
-                insertKeyCharQuery.bindValue(2, QString(keyChar->value()));
-                insertKeyCharQuery.bindValue(3, keyChar->modifier());
-                insertKeyCharQuery.exec();
-
-                if (insertKeyCharQuery.lastError().isValid())
-                {
-                    qWarning() << insertKeyCharQuery.lastError().text();
-                    raiseError(insertKeyCharQuery.lastError());
-                    db.rollback();
-                    return false;
-                }
-            }
+            keyIds.append(keyId);
         }
 
         if (SpecialKey* const specialKey = qobject_cast<SpecialKey*>(abstractKey))
@@ -588,6 +895,8 @@ bool UserDataAccess::storeKeyboardLayout(KeyboardLayout* keyboardLayout)
                 db.rollback();
                 return false;
             }
+
+            keyIds.append(insertSpecialKeyQuery.lastInsertId().toInt());
         }
     }
 
@@ -599,6 +908,37 @@ bool UserDataAccess::storeKeyboardLayout(KeyboardLayout* keyboardLayout)
         return false;
     }
 
+    for (int i = 0; i < keyIds.count(); i++)
+    {
+        keyboardLayout->key(rewriteFrom + i)->setStorageId(keyIds.at(i));
+    }
+
+    keyboardLayout->startChangeTracking();
+
+    return true;
+}
+
+bool UserDataAccess::insertKeyChars(QSqlQuery& insertKeyCharQuery, Key* key, int keyId)
+{
+    insertKeyCharQuery.bindValue(0, keyId);
+
+    for (int j = 0; j < key->keyCharCount(); j++)
+    {
+        KeyChar * const keyChar = key->keyChar(j);
+
+        insertKeyCharQuery.bindValue(1, keyChar->position());
+        insertKeyCharQuery.bindValue(2, QString(keyChar->value()));
+        insertKeyCharQuery.bindValue(3, keyChar->modifier());
+        insertKeyCharQuery.exec();
+
+        if (insertKeyCharQuery.lastError().isValid())
+        {
+            qWarning() << insertKeyCharQuery.lastError().text();
+            raiseError(insertKeyCharQuery.lastError());
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -618,7 +958,7 @@ bool UserDataAccess::deleteKeyboardLayout(KeyboardLayout* keyboardLayout)
 
     QSqlQuery deleteKeyCharsQuery(db);
 
-    deleteKeyCharsQuery.prepare("DELETE FROM keyboard_layout_key_chars WHERE key_id IN (SELECT id FROM keyboard_layout_keys WHERE keyboard_layout_id = ?)");
+    prepareQuery(deleteKeyCharsQuery, "DELETE FROM keyboard_layout_key_chars WHERE key_id IN (SELECT id FROM keyboard_layout_keys WHERE keyboard_layout_id = ?)");
     deleteKeyCharsQuery.bindValue(0, keyboardLayout->id());
     deleteKeyCharsQuery.exec();
 
@@ -633,7 +973,7 @@ bool UserDataAccess::deleteKeyboardLayout(KeyboardLayout* keyboardLayout)
 
     QSqlQuery deleteKeysQuery(db);
 
-    deleteKeysQuery.prepare("DELETE FROM keyboard_layout_keys WHERE keyboard_layout_id = ?");
+    prepareQuery(deleteKeysQuery, "DELETE FROM keyboard_layout_keys WHERE keyboard_layout_id = ?");
     deleteKeysQuery.bindValue(0, keyboardLayout->id());
     deleteKeysQuery.exec();
 
@@ -647,7 +987,7 @@ bool UserDataAccess::deleteKeyboardLayout(KeyboardLayout* keyboardLayout)
 
     QSqlQuery deleteKeyboardLayoutQuery(db);
 
-    deleteKeyboardLayoutQuery.prepare("DELETE FROM keyboard_layouts WHERE id = ?");
+    prepareQuery(deleteKeyboardLayoutQuery, "DELETE FROM keyboard_layouts WHERE id = ?");
     deleteKeyboardLayoutQuery.bindValue(0, keyboardLayout->id());
     deleteKeyboardLayoutQuery.exec();
 
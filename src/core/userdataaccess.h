@@ -23,6 +23,8 @@
 class DataIndex;
 class Course;
 class KeyboardLayout;
+class Key;
+class QSqlQuery;
 
 class UserDataAccess : public DbAccess
 {
@@ -31,11 +33,14 @@ public:
     explicit UserDataAccess(QObject* parent = 0);
     Q_INVOKABLE bool fillDataIndex(DataIndex* target);
     Q_INVOKABLE bool loadCourse(const QString& id, Course* target);
+    QString loadLessonText(const QString& courseId, const QString& lessonId);
     Q_INVOKABLE bool storeCourse(Course* course);
     Q_INVOKABLE bool deleteCourse(Course* course);
     Q_INVOKABLE bool loadKeyboardLayout(const QString& id, KeyboardLayout* target);
     Q_INVOKABLE bool storeKeyboardLayout(KeyboardLayout* keyboardLayout);
     Q_INVOKABLE bool deleteKeyboardLayout(KeyboardLayout* keyboardLayout);
+private:
+    bool insertKeyChars(QSqlQuery& insertKeyCharQuery, Key* key, int keyId);
 };
 
 #endif // USERDATAACCESS_H
@@ -0,0 +1,65 @@
+/*
+ *  Copyright 2026  agent <agent@local>
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <QByteArray>
+
+/**
+ * Variable length encoding of unsigned integers, seven bits per byte with
+ * the high bit set on all but the last byte. Small values, like most
+ * counts and time deltas, take a single byte.
+ */
+
+inline void appendVarint(QByteArray& data, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        data.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+
+    data.append(char(value));
+}
+
+/**
+ * Reads a value at @p pos and advances @p pos behind it. Returns false
+ * if the data ends in the middle of a value or the value doesn't fit in
+ * 64 bits.
+ */
+inline bool readVarint(const char*& pos, const char* end, quint64& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos == end)
+            return false;
+
+        const uchar byte = uchar(*pos++);
+        value |= quint64(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+#endif // VARINT_H
@@ -19,14 +19,32 @@
 
 #include <qmath.h>
 #include <QAbstractTextDocumentLayout>
+#include <QCache>
+#include <QCryptographicHash>
+#include <QImage>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPainter>
+#include <QQuickWindow>
+#include <QSGSimpleTextureNode>
+#include <QtConcurrentRun>
 #include <QTextCharFormat>
 #include <QTextCursor>
 #include <QTextDocument>
 #include <QTextFrame>
+#include <QThread>
 
 #include "core/lesson.h"
 #include "declarativeitems/traininglinecore.h"
+#include "preferences.h"
+
+Q_LOGGING_CATEGORY(lessonPainterTiming, "ktouch.timing.lessonpainter", QtWarningMsg)
+
+// lessons with more lines than this only keep a window of lines around the
+// current one in the text document, see updateWindow()
+static const int WindowedLayoutThreshold = 200;
+static const int WindowRadius = 50;
 
 struct LessonPainterPrivate
 {
@@ -63,26 +81,141 @@ struct LessonPainterPrivate
     QTextCharFormat titleCharFormat;
 };
 
+// the document metrics of recently shown lessons, so a lesson shown again
+// is laid out once at its known width instead of twice to find it out.
+// Shared between the GUI thread and the prefetching worker threads.
+
+struct LayoutMetrics
+{
+    qreal width;
+    qreal lineHeight;
+};
+
+static QCache<QByteArray, LayoutMetrics> layoutMetricsCache(32);
+static QMutex layoutMetricsCacheMutex;
+
+static QByteArray layoutMetricsKey(const LessonPainterPrivate& formats, const QString& title, const QString& text)
+{
+    // the viewport isn't part of the key, scaling the document to it is cheap
+    // and doesn't need a relayout
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(formats.titleCharFormat.font().toString().toUtf8());
+    hash.addData(formats.textCharFormat.font().toString().toUtf8());
+    hash.addData(QByteArray::number(formats.blockFormat.lineHeight()));
+    hash.addData(title.toUtf8());
+    hash.addData(text.toUtf8());
+    return hash.result();
+}
+
+static QString documentKey(const QString& title, const QString& text, bool placeHolders)
+{
+    return QString("%1\n%2\n%3").arg(placeHolders).arg(title).arg(text);
+}
+
+static void insertTitle(QTextCursor& cursor, const LessonPainterPrivate& formats, const QString& title)
+{
+    QTextBlockFormat blockFormat = formats.blockFormat;
+
+    blockFormat.setAlignment(title.isRightToLeft()? Qt::AlignRight: Qt::AlignLeft);
+    cursor.setBlockFormat(blockFormat);
+    cursor.setBlockCharFormat(formats.titleCharFormat);
+    cursor.insertText(title);
+}
+
+static void insertLine(QTextCursor& cursor, const LessonPainterPrivate& formats, const QString& line, bool placeHolders)
+{
+    cursor.insertBlock(formats.blockFormat, placeHolders? formats.placeHolderCharFormat: formats.textCharFormat);
+    cursor.insertText(line);
+}
+
+static void measureWindowedLayout(const LessonPainterPrivate& formats, const QString& title, const QStringList& lines, qreal documentMargin, qreal* width, qreal* lineHeight)
+{
+    // the width of the whole lesson is taken from its longest line, the
+    // lines are assumed to be of uniform height. Two copies of the line are
+    // needed to get the distance between lines including the line spacing.
+
+    int longestLine = 0;
+
+    for (int i = 1; i < lines.length(); i++)
+    {
+        if (lines.at(i).length() > lines.at(longestLine).length())
+        {
+            longestLine = i;
+        }
+    }
+
+    QTextDocument doc;
+    doc.setUseDesignMetrics(true);
+    doc.setDocumentMargin(documentMargin);
+
+    QTextCursor cursor(&doc);
+    insertTitle(cursor, formats, title);
+    insertLine(cursor, formats, lines.at(longestLine), false);
+    insertLine(cursor, formats, lines.at(longestLine), false);
+
+    const QAbstractTextDocumentLayout* docLayout = doc.documentLayout();
+    const QTextBlock lastBlock = doc.lastBlock();
+
+    *width = doc.idealWidth();
+    *lineHeight = docLayout->blockBoundingRect(lastBlock).top() - docLayout->blockBoundingRect(lastBlock.previous()).top();
+}
+
 LessonPainter::LessonPainter(QQuickItem* parent) :
-    QQuickPaintedItem(parent),
+    QQuickItem(parent),
     d(new LessonPainterPrivate()),
+    m_renderer(Preferences::lessonRenderer() == Preferences::EnumLessonRenderer::PixmapRenderer? PixmapRenderer: SceneGraphRenderer),
+    m_nodeRenderer(m_renderer),
     m_doc(new QTextDocument(this)),
+    m_docPristine(false),
+    m_docWidth(0),
     m_textScale(1.0),
     m_maximumWidth(0),
     m_maximumHeight(-1),
     m_imageCacheDirty(false),
+    m_lineNodesDirty(false),
     m_trainingLineCore(0),
-    m_currentLine(0)
+    m_currentLine(0),
+    m_windowed(false),
+    m_windowStart(0),
+    m_windowEnd(0),
+    m_lineHeight(0),
+    m_prefetchWatcher(new QFutureWatcher<LessonDocument>(this)),
+    m_renderedLine(-1)
 {
-    this->setFlag(QQuickPaintedItem::ItemHasContents, true);
+    this->setFlag(QQuickItem::ItemHasContents, true);
     m_doc->setUseDesignMetrics(true);
+    connect(m_prefetchWatcher, SIGNAL(finished()), SLOT(prefetchFinished()));
 }
 
 LessonPainter::~LessonPainter()
 {
+    if (m_prefetchWatcher->isRunning())
+    {
+        m_prefetchWatcher->waitForFinished();
+        delete m_prefetchWatcher->result().doc;
+    }
+
+    delete m_prefetchedDocument.doc;
     delete d;
 }
 
+LessonPainter::Renderer LessonPainter::renderer() const
+{
+    return m_renderer;
+}
+
+void LessonPainter::setRenderer(Renderer renderer)
+{
+    if (renderer != m_renderer)
+    {
+        m_renderer = renderer;
+        invalidateImageCache();
+        update();
+        emit rendererChanged();
+    }
+}
+
 Lesson* LessonPainter::lesson() const
 {
     return m_lesson;
@@ -164,6 +297,10 @@ void LessonPainter::setTrainingLineCore(TrainingLineCore* trainingLineCore)
             connect(m_trainingLineCore, SIGNAL(preeditStringChanged()), SLOT(updateTrainingStatus()));
             connect(m_trainingLineCore, SIGNAL(done()), SLOT(advanceToNextTrainingLine()));
         }
+
+        // the document depends on the core for its placeholders, and the
+        // rendered char states cached for the old one don't apply anymore
+        reset();
     }
 }
 
@@ -172,6 +309,15 @@ QRectF LessonPainter::cursorRectangle() const
     return m_cursorRectangle;
 }
 
+void LessonPainter::prefetchLesson(Lesson* lesson)
+{
+    if (!lesson)
+        return;
+
+    m_prefetchLesson = lesson;
+    startPrefetch();
+}
+
 void LessonPainter::reset()
 {
     m_lines = m_lesson? m_lesson->text().split('\n'): QStringList();
@@ -179,10 +325,33 @@ void LessonPainter::reset()
     resetTrainingStatus();
 }
 
-void LessonPainter::paint(QPainter* painter)
+QSGNode* LessonPainter::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data)
 {
-    checkImageCache();
-    painter->drawPixmap(0, 0, m_imageCache);
+    Q_UNUSED(data)
+
+    if (oldNode && m_nodeRenderer != m_renderer)
+    {
+        delete oldNode;
+        oldNode = 0;
+    }
+
+    if (qFloor(width()) <= 0 || qFloor(height()) <= 0)
+    {
+        delete oldNode;
+        return 0;
+    }
+
+    m_nodeRenderer = m_renderer;
+
+    QSGNode* node = m_renderer == SceneGraphRenderer? updateLineNodes(oldNode): updateImageNode(oldNode);
+
+    if (m_keystrokeTimer.isValid())
+    {
+        qCDebug(lessonPainterTiming) << "keystroke to paint:" << m_keystrokeTimer.nsecsElapsed() / 1000 << "us";
+        m_keystrokeTimer.invalidate();
+    }
+
+    return node;
 }
 
 void LessonPainter::updateLayout()
@@ -196,23 +365,23 @@ void LessonPainter::updateLayout()
         return;
     }
 
-    // ### reset text width from previous run
-    m_doc->setTextWidth(-1);
+    // in windowed mode the lines after the window are accounted for by
+    // their estimated height, for the preview the lesson is cut off instead
 
-    const qreal docWidth = m_doc->idealWidth();
-    const qreal docHeight = m_doc->size().height();
+    const qreal docWidth = m_docWidth;
+    const qreal docHeight = m_windowed && m_trainingLineCore?
+                m_doc->size().height() + (m_lines.length() - m_windowEnd) * m_lineHeight:
+                m_doc->size().height();
 
     m_textScale = m_maximumHeight != -1?
                 qMin(m_maximumWidth / docWidth, m_maximumHeight / docHeight):
                 m_maximumWidth / docWidth;
 
-    // ### without this text alignment won't work
-    m_doc->setTextWidth(docWidth);
-
     setWidth(qCeil(docWidth * m_textScale));
     setHeight(qCeil(docHeight * m_textScale));
 
     updateCursorRectangle();
+    update();
 }
 
 void LessonPainter::resetTrainingStatus()
@@ -230,37 +399,89 @@ void LessonPainter::updateTrainingStatus()
     if (m_currentLine >= m_lines.length())
         return;
 
-    QTextCursor cursor(m_doc);
+    m_keystrokeTimer.start();
 
     const QString referenceLine = m_trainingLineCore->referenceLine();
     const QString actualLine = m_trainingLineCore->actualLine();
     const QString preeditString = m_trainingLineCore->preeditString();
-    const QTextBlock block = m_doc->findBlockByNumber(m_currentLine + 1);
+    const int firstErrorPosition = m_trainingLineCore->firstErrorPosition();
+    const QTextBlock block = blockForLine(m_currentLine);
     const int blockPosition = block.position();
 
+    // a line nobody has typed on yet still shows its reference text as
+    // placeholders, exactly like updateDoc() has inserted it
+
+    if (m_renderedLine != m_currentLine || m_renderedChars.length() != referenceLine.length())
+    {
+        m_renderedLine = m_currentLine;
+        m_renderedChars = referenceLine;
+        m_renderedCharStates.fill(PlaceHolderCharState, referenceLine.length());
+    }
+
+    QTextCursor cursor(m_doc);
+    bool changed = false;
+
     for (int linePos = 0; linePos < referenceLine.length(); linePos++)
     {
         const bool typed = linePos < actualLine.length();
         const bool preedit = !typed &&  linePos - actualLine.length() < preeditString.length();
-        const bool correct = typed && actualLine.at(linePos) == referenceLine.at(linePos);
+        const bool correct = typed &&
+                (firstErrorPosition == -1 || linePos < firstErrorPosition || actualLine.at(linePos) == referenceLine.at(linePos));
 
-        const QTextCharFormat charFormat = typed?
-                    (correct? d->textCharFormat: d->errorCharFormat):
-                    (preedit? d->preeditCharFromat: d->placeHolderCharFormat);
+        const CharState charState = typed?
+                    (correct? CorrectCharState: ErrorCharState):
+                    (preedit? PreeditCharState: PlaceHolderCharState);
 
         const QChar displayedChar = typed?
                     actualLine.at(linePos):
                     preedit? preeditString.at(linePos - actualLine.length()): referenceLine.at(linePos);
 
+        if (charState == m_renderedCharStates.at(linePos) && displayedChar == m_renderedChars.at(linePos))
+            continue;
+
+        if (!changed)
+        {
+            cursor.beginEditBlock();
+            changed = true;
+            m_docPristine = false;
+        }
+
+        const QTextCharFormat charFormat =
+                charState == CorrectCharState? d->textCharFormat:
+                charState == ErrorCharState? d->errorCharFormat:
+                charState == PreeditCharState? d->preeditCharFromat:
+                d->placeHolderCharFormat;
+
         const int charPosition = blockPosition + linePos;
 
         cursor.setPosition(charPosition, QTextCursor::MoveAnchor);
         cursor.setPosition(charPosition + 1, QTextCursor::KeepAnchor);
-        cursor.deleteChar();
-        cursor.insertText(QString(displayedChar), charFormat);
+
+        if (displayedChar == m_renderedChars.at(linePos))
+        {
+            cursor.setCharFormat(charFormat);
+        }
+        else
+        {
+            cursor.insertText(QString(displayedChar), charFormat);
+            m_renderedChars[linePos] = displayedChar;
+        }
+
+        m_renderedCharStates[linePos] = charState;
     }
 
-    invalidateImageCache();
+    if (!changed)
+    {
+        m_keystrokeTimer.invalidate();
+        updateCursorRectangle();
+        return;
+    }
+
+    cursor.endEditBlock();
+
+    qCDebug(lessonPainterTiming) << "training status update:" << m_keystrokeTimer.nsecsElapsed() / 1000 << "us";
+
+    invalidateBlock(block.blockNumber());
     updateCursorRectangle();
     update();
 }
@@ -271,6 +492,7 @@ void LessonPainter::advanceToNextTrainingLine()
 
     if (m_currentLine < m_lines.length())
     {
+        updateWindow();
         m_trainingLineCore->setReferenceLine(m_lines.at(m_currentLine));
     }
     else
@@ -280,59 +502,343 @@ void LessonPainter::advanceToNextTrainingLine()
     }
 }
 
+LessonPainter::LessonDocument LessonPainter::createDocument(LessonPainterPrivate formats, QString title, QString text, bool placeHolders, QThread* thread)
+{
+    // runs on the GUI thread as well as on worker threads for prefetching,
+    // so everything needed is passed in by value
+
+    LessonDocument lessonDocument;
+    QTextDocument* doc = new QTextDocument();
+    const QStringList lines = text.split('\n');
+    const bool windowed = lines.length() > WindowedLayoutThreshold;
+    const int lineCount = windowed? 2 * WindowRadius: lines.length();
+    const QByteArray metricsKey = layoutMetricsKey(formats, title, text);
+    bool metricsCached = false;
+
+    {
+        QMutexLocker locker(&layoutMetricsCacheMutex);
+
+        if (LayoutMetrics* metrics = layoutMetricsCache.object(metricsKey))
+        {
+            lessonDocument.width = metrics->width;
+            lessonDocument.lineHeight = metrics->lineHeight;
+            metricsCached = true;
+        }
+    }
+
+    doc->setUseDesignMetrics(true);
+    doc->setDocumentMargin(20.0);
+
+    if (metricsCached)
+    {
+        // ### without this text alignment won't work
+        doc->setTextWidth(lessonDocument.width);
+    }
+
+    QTextCursor cursor(doc);
+
+    insertTitle(cursor, formats, title);
+
+    for (int i = 0; i < lineCount; i++)
+    {
+        insertLine(cursor, formats, lines.at(i), placeHolders);
+    }
+
+    if (!metricsCached)
+    {
+        if (windowed)
+        {
+            measureWindowedLayout(formats, title, lines, doc->documentMargin(), &lessonDocument.width, &lessonDocument.lineHeight);
+        }
+        else
+        {
+            lessonDocument.width = doc->idealWidth();
+        }
+
+        // ### without this text alignment won't work
+        doc->setTextWidth(lessonDocument.width);
+
+        LayoutMetrics* metrics = new LayoutMetrics;
+        metrics->width = lessonDocument.width;
+        metrics->lineHeight = lessonDocument.lineHeight;
+
+        QMutexLocker locker(&layoutMetricsCacheMutex);
+        layoutMetricsCache.insert(metricsKey, metrics);
+    }
+
+    // force the layout of the document
+    doc->size();
+
+    doc->moveToThread(thread);
+    lessonDocument.doc = doc;
+
+    return lessonDocument;
+}
+
 void LessonPainter::updateDoc()
 {
-    m_doc->clear();
+    m_renderedLine = -1;
+    m_windowed = m_lines.length() > WindowedLayoutThreshold;
+    m_windowStart = 0;
+    m_windowEnd = m_windowed? 2 * WindowRadius: m_lines.length();
 
     if (!m_lesson) {
+        m_doc->clear();
+        m_docKey.clear();
+        m_docPristine = false;
+        m_docWidth = 0;
         updateLayout();
         return;
     }
 
-    m_doc->setDocumentMargin(20.0);
+    const QString title = m_lesson->title();
+    const QString text = m_lesson->text();
+    const bool placeHolders = m_trainingLineCore != 0;
+    const QString key = documentKey(title, text, placeHolders);
+
+    if (key == m_docKey && m_docPristine)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    LessonDocument lessonDocument;
+
+    if (m_prefetchedDocument.doc && key == m_prefetchedKey)
+    {
+        lessonDocument = m_prefetchedDocument;
+        m_prefetchedDocument = LessonDocument();
+        m_prefetchedKey.clear();
+    }
+    else
+    {
+        lessonDocument = createDocument(*d, title, text, placeHolders, thread());
+    }
+
+    delete m_doc;
+    m_doc = lessonDocument.doc;
+    m_doc->setParent(this);
+    m_docKey = key;
+    m_docPristine = true;
+    m_docWidth = lessonDocument.width;
+    m_lineHeight = lessonDocument.lineHeight;
+
+    qCDebug(lessonPainterTiming) << "document update:" << timer.nsecsElapsed() / 1000 << "us";
+
+    updateLayout();
+}
+
+void LessonPainter::startPrefetch()
+{
+    if (!m_prefetchLesson || m_prefetchWatcher->isRunning())
+        return;
+
+    const QString title = m_prefetchLesson->title();
+    const QString text = m_prefetchLesson->text();
+    const bool placeHolders = m_trainingLineCore != 0;
+    const QString key = documentKey(title, text, placeHolders);
+
+    m_prefetchLesson.clear();
+
+    if (key == m_prefetchedKey || (key == m_docKey && m_docPristine))
+        return;
+
+    m_prefetchKey = key;
+    m_prefetchWatcher->setFuture(QtConcurrent::run(&LessonPainter::createDocument, *d, title, text, placeHolders, thread()));
+}
+
+void LessonPainter::prefetchFinished()
+{
+    delete m_prefetchedDocument.doc;
+    m_prefetchedDocument = m_prefetchWatcher->result();
+    m_prefetchedKey = m_prefetchKey;
+    startPrefetch();
+}
+
+void LessonPainter::updateWindow()
+{
+    if (!m_windowed || m_windowEnd == m_lines.length() || m_currentLine + WindowRadius / 2 < m_windowEnd)
+        return;
+
+    const int windowStart = qMax(0, m_currentLine - WindowRadius);
+    const int windowEnd = qMin(m_lines.length(), m_currentLine + WindowRadius);
 
     QTextCursor cursor(m_doc);
-    QTextBlockFormat blockFormat = d->blockFormat;
+    cursor.beginEditBlock();
+    m_docPristine = false;
 
-    const QString lessonTitle = m_lesson->title();
+    // drop the lines above the new window, including the block separator
+    // before each of them, but keep the one of the new first line
 
-    blockFormat.setAlignment(lessonTitle.isRightToLeft()? Qt::AlignRight: Qt::AlignLeft);
-    cursor.setBlockFormat(blockFormat);
-    cursor.setBlockCharFormat(d->titleCharFormat);
-    cursor.insertText(lessonTitle);
+    if (windowStart > m_windowStart)
+    {
+        cursor.setPosition(blockForLine(m_windowStart).position() - 1);
+        cursor.setPosition(blockForLine(windowStart).position() - 1, QTextCursor::KeepAnchor);
+        cursor.removeSelectedText();
+        m_windowStart = windowStart;
+    }
 
-    const QTextCharFormat textFormat = m_trainingLineCore? d->placeHolderCharFormat: d->textCharFormat;
+    cursor.movePosition(QTextCursor::End);
 
-    foreach (const QString& line, m_lines)
+    for (int i = m_windowEnd; i < windowEnd; i++)
     {
-        blockFormat.setAlignment(line.isRightToLeft()? Qt::AlignRight: Qt::AlignLeft);
-        cursor.insertBlock(d->blockFormat, textFormat);
-        cursor.insertText(line);
+        insertLine(cursor, *d, m_lines.at(i), m_trainingLineCore != 0);
     }
 
+    m_windowEnd = windowEnd;
+
+    // the removed lines are replaced by an equally high margin
+
+    QTextBlockFormat blockFormat = d->blockFormat;
+    blockFormat.setTopMargin(m_windowStart * m_lineHeight);
+    cursor.setPosition(blockForLine(m_windowStart).position());
+    cursor.setBlockFormat(blockFormat);
+
+    cursor.endEditBlock();
 
     updateLayout();
 }
 
+QTextBlock LessonPainter::blockForLine(int line) const
+{
+    return m_doc->findBlockByNumber(line - m_windowStart + 1);
+}
+
+QRectF LessonPainter::blockRect(const QTextBlock& block) const
+{
+    // the bounding rect without the top margin of the first line in the
+    // window, so that it isn't rendered as one huge transparent texture
+
+    QRectF rect = m_doc->documentLayout()->blockBoundingRect(block);
+    const QTextLayout* layout = block.layout();
+
+    if (layout->lineCount() > 0)
+    {
+        rect.setTop(qMax(rect.top(), layout->position().y() + layout->lineAt(0).y()));
+    }
+
+    return rect;
+}
+
 void LessonPainter::invalidateImageCache()
 {
     m_imageCacheDirty = true;
-    m_imageCache = QPixmap();
+    m_lineNodesDirty = true;
+    m_dirtyBlocks.clear();
 }
 
-void LessonPainter::checkImageCache()
+void LessonPainter::invalidateBlock(int blockNumber)
 {
+    m_imageCacheDirty = true;
+    m_dirtyBlocks.insert(blockNumber);
+}
+
+QSGNode* LessonPainter::updateImageNode(QSGNode* oldNode)
+{
+    QSGSimpleTextureNode* node = static_cast<QSGSimpleTextureNode*>(oldNode);
+
+    if (!node)
+    {
+        node = new QSGSimpleTextureNode();
+        node->setOwnsTexture(true);
+        m_imageCacheDirty = true;
+    }
+
     if (!m_imageCacheDirty)
-        return;
+        return node;
 
-    QPixmap img(qFloor(width()), qFloor(height()));
+    // only the part of the item covered by the windowed document is
+    // rendered, the title is left out once the window has moved on
+
+    const int top = m_windowStart > 0? qFloor(m_textScale * blockRect(blockForLine(m_windowStart)).top()): 0;
+    const int bottom = qMin(qFloor(height()), qCeil(m_textScale * m_doc->size().height()));
+
+    QImage img(qFloor(width()), qMax(1, bottom - top), QImage::Format_ARGB32_Premultiplied);
     img.fill(Qt::transparent);
     QPainter painter(&img);
+    painter.translate(0, -top);
     painter.scale(m_textScale, m_textScale);
-    m_doc->drawContents(&painter);
+    m_doc->drawContents(&painter, QRectF(0, top / m_textScale, m_doc->size().width(), img.height() / m_textScale));
+    painter.end();
+
+    node->setTexture(window()->createTextureFromImage(img));
+    node->setRect(0, top, img.width(), img.height());
 
-    m_imageCache = img;
     m_imageCacheDirty = false;
+    m_dirtyBlocks.clear();
+
+    return node;
+}
+
+QSGNode* LessonPainter::updateLineNodes(QSGNode* oldNode)
+{
+    // one texture per text block, so a keystroke only re-rasterizes the
+    // line being typed while all other textures are reused as they are
+
+    QSGNode* node = oldNode;
+
+    if (!node)
+    {
+        node = new QSGNode();
+        m_lineNodesDirty = true;
+    }
+
+    if (m_lineNodesDirty)
+    {
+        while (QSGNode* child = node->firstChild())
+        {
+            node->removeChildNode(child);
+            delete child;
+        }
+    }
+    else if (m_dirtyBlocks.isEmpty())
+    {
+        return node;
+    }
+
+    for (QTextBlock block = m_doc->begin(); block.isValid(); block = block.next())
+    {
+        const int blockNumber = block.blockNumber();
+
+        if (!m_lineNodesDirty && !m_dirtyBlocks.contains(blockNumber))
+            continue;
+
+        const QRectF rect = blockRect(block);
+        const QRect nodeRect(
+                    qFloor(m_textScale * rect.x()),
+                    qFloor(m_textScale * rect.y()),
+                    qMax(1, qCeil(m_textScale * rect.width())),
+                    qMax(1, qCeil(m_textScale * rect.height())));
+
+        QImage img(nodeRect.size(), QImage::Format_ARGB32_Premultiplied);
+        img.fill(Qt::transparent);
+        QPainter painter(&img);
+        painter.translate(-nodeRect.topLeft());
+        painter.scale(m_textScale, m_textScale);
+        m_doc->drawContents(&painter, rect);
+        painter.end();
+
+        QSGSimpleTextureNode* lineNode;
+
+        if (m_lineNodesDirty)
+        {
+            lineNode = new QSGSimpleTextureNode();
+            lineNode->setOwnsTexture(true);
+            node->appendChildNode(lineNode);
+        }
+        else
+        {
+            lineNode = static_cast<QSGSimpleTextureNode*>(node->childAtIndex(blockNumber));
+        }
+
+        lineNode->setTexture(window()->createTextureFromImage(img));
+        lineNode->setRect(nodeRect);
+    }
+
+    m_lineNodesDirty = false;
+    m_dirtyBlocks.clear();
+
+    return node;
 }
 
 void LessonPainter::updateCursorRectangle()
@@ -342,7 +848,7 @@ void LessonPainter::updateCursorRectangle()
 
     const QString actualLine = m_trainingLineCore->actualLine();
     const QString preeditString = m_trainingLineCore->preeditString();
-    const QTextBlock block = m_doc->findBlockByNumber(m_currentLine + 1);
+    const QTextBlock block = blockForLine(m_currentLine);
     const QAbstractTextDocumentLayout* docLayout = m_doc->documentLayout();
     const QTextLayout* layout = block.layout();
     const QPointF blockPos = docLayout->blockBoundingRect(block).topLeft();
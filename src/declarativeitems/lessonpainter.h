@@ -18,29 +18,46 @@
 #ifndef LESSONPAINTER_H
 #define LESSONPAINTER_H
 
-#include <QQuickPaintedItem>
-#include <QPixmap>
+#include <QQuickItem>
 
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QPointer>
+#include <QSet>
+#include <QVector>
 
+class QSGNode;
+class QTextBlock;
+class QTextCursor;
 class QTextDocument;
 class QTextFrame;
+class QThread;
 
 class Lesson;
 class TrainingLineCore;
 struct LessonPainterPrivate;
 
-class LessonPainter : public QQuickPaintedItem
+class LessonPainter : public QQuickItem
 {
     Q_OBJECT
+    Q_ENUMS(Renderer)
+    Q_PROPERTY(Renderer renderer READ renderer WRITE setRenderer NOTIFY rendererChanged)
     Q_PROPERTY(Lesson* lesson READ lesson WRITE setLesson NOTIFY lessonChanged)
     Q_PROPERTY(qreal maximumWidth READ maximumWidth WRITE setMaximumWidth NOTIFY maximumWidthChanged)
     Q_PROPERTY(qreal maximumHeight READ maximumHeight WRITE setMaximumHeight NOTIFY maximumHeightChanged)
     Q_PROPERTY(TrainingLineCore* trainingLineCore READ trainingLineCore WRITE setTrainingLineCore NOTIFY trainingLineCoreChanged)
     Q_PROPERTY(QRectF cursorRectangle READ cursorRectangle NOTIFY cursorRectangleChanged)
 public:
+    enum Renderer
+    {
+        PixmapRenderer,
+        SceneGraphRenderer
+    };
+
     explicit LessonPainter(QQuickItem* parent = 0);
     ~LessonPainter();
+    Renderer renderer() const;
+    void setRenderer(Renderer renderer);
     Lesson* lesson() const;
     void setLesson(Lesson* lesson);
     qreal maximumWidth() const;
@@ -50,9 +67,11 @@ public:
     TrainingLineCore* trainingLineCore() const;
     void setTrainingLineCore(TrainingLineCore* trainingLineCore);
     QRectF cursorRectangle() const;
+    Q_INVOKABLE void prefetchLesson(Lesson* lesson);
 public slots:
     void reset();
 signals:
+    void rendererChanged();
     void lessonChanged();
     void maximumWidthChanged();
     void maximumHeightChanged();
@@ -60,28 +79,69 @@ signals:
     void cursorRectangleChanged();
     void done();
 protected:
-    void paint(QPainter* painter);
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data);
 private slots:
     void updateLayout();
     void resetTrainingStatus();
     void updateTrainingStatus();
     void advanceToNextTrainingLine();
+    void prefetchFinished();
 private:
+    struct LessonDocument
+    {
+        LessonDocument(): doc(0), width(0), lineHeight(0) {}
+        QTextDocument* doc;
+        qreal width;
+        qreal lineHeight;
+    };
+    enum CharState
+    {
+        PlaceHolderCharState,
+        CorrectCharState,
+        ErrorCharState,
+        PreeditCharState
+    };
+    static LessonDocument createDocument(LessonPainterPrivate formats, QString title, QString text, bool placeHolders, QThread* thread);
     void updateDoc();
+    void startPrefetch();
+    void updateWindow();
+    QTextBlock blockForLine(int line) const;
+    QRectF blockRect(const QTextBlock& block) const;
     void invalidateImageCache();
-    void checkImageCache();
+    void invalidateBlock(int blockNumber);
+    QSGNode* updateImageNode(QSGNode* oldNode);
+    QSGNode* updateLineNodes(QSGNode* oldNode);
     void updateCursorRectangle();
     LessonPainterPrivate* d;
+    Renderer m_renderer;
+    Renderer m_nodeRenderer;
     QPointer<Lesson> m_lesson;
     QStringList m_lines;
     QTextDocument* m_doc;
+    QString m_docKey;
+    bool m_docPristine;
+    qreal m_docWidth;
     qreal m_textScale;
     qreal m_maximumWidth;
     qreal m_maximumHeight;
-    QPixmap m_imageCache;
     bool m_imageCacheDirty;
+    bool m_lineNodesDirty;
+    QSet<int> m_dirtyBlocks;
     TrainingLineCore* m_trainingLineCore;
     int m_currentLine;
+    bool m_windowed;
+    int m_windowStart;
+    int m_windowEnd;
+    qreal m_lineHeight;
+    QPointer<Lesson> m_prefetchLesson;
+    QFutureWatcher<LessonDocument>* m_prefetchWatcher;
+    QString m_prefetchKey;
+    LessonDocument m_prefetchedDocument;
+    QString m_prefetchedKey;
+    int m_renderedLine;
+    QString m_renderedChars;
+    QVector<CharState> m_renderedCharStates;
+    QElapsedTimer m_keystrokeTimer;
     QPointer<QQuickItem> m_cursorItem;
     QRectF m_cursorRectangle;
 };
@@ -17,16 +17,21 @@
 
 #include "traininglinecore.h"
 
+#include <QElapsedTimer>
 #include <QKeyEvent>
+#include <QLoggingCategory>
 #include <QTextBoundaryFinder>
 
 #include "core/trainingstats.h"
 #include "preferences.h"
 
+Q_LOGGING_CATEGORY(trainingLineCoreTiming, "ktouch.timing.traininglinecore", QtWarningMsg)
+
 TrainingLineCore::TrainingLineCore(QQuickItem* parent) :
     QQuickItem(parent),
     m_active(false),
     m_trainingStats(0),
+    m_firstErrorPosition(-1),
     m_hintKey(-1),
     m_keyHintOccurrenceCount(0)
 {
@@ -71,6 +76,12 @@ void TrainingLineCore::setTrainingStats(TrainingStats* trainingStats)
     if (trainingStats != m_trainingStats)
     {
         m_trainingStats = trainingStats;
+
+        if (m_trainingStats)
+        {
+            m_trainingStats->reserve(m_referenceLine);
+        }
+
         emit trainingStatsChanged();
     }
 }
@@ -85,7 +96,15 @@ void TrainingLineCore::setReferenceLine(const QString& referenceLine)
     if (referenceLine != m_referenceLine)
     {
         m_referenceLine = referenceLine;
-        m_actualLine = "";
+        m_actualLine.resize(0);
+        m_actualLine.reserve(m_referenceLine.length());
+        m_firstErrorPosition = -1;
+
+        if (m_trainingStats)
+        {
+            m_trainingStats->reserve(m_referenceLine);
+        }
+
         clearKeyHint();
         emit referenceLineChanged();
         emit actualLineChanged();
@@ -107,7 +126,12 @@ bool TrainingLineCore::isCorrect() const
     if (!Preferences::enforceTypingErrorCorrection())
         return true;
 
-    return m_actualLine == m_referenceLine.left(m_actualLine.length());
+    return m_firstErrorPosition == -1;
+}
+
+int TrainingLineCore::firstErrorPosition() const
+{
+    return m_firstErrorPosition;
 }
 
 QString TrainingLineCore::nextCharacter() const
@@ -130,7 +154,8 @@ int TrainingLineCore::hintKey() const
 void TrainingLineCore::reset()
 {
     m_referenceLine = "";
-    m_actualLine = "";
+    m_actualLine.resize(0);
+    m_firstErrorPosition = -1;
     clearKeyHint();
     emit referenceLineChanged();
     emit actualLineChanged();
@@ -182,7 +207,9 @@ void TrainingLineCore::keyPressEvent(QKeyEvent* event)
 
     bool unknown = false;
 
-    if (event == QKeySequence::DeleteStartOfWord)
+    // matching a key sequence builds the list of its key bindings, only do
+    // that for the keys which can be part of it
+    if (event->key() == Qt::Key_Backspace && event == QKeySequence::DeleteStartOfWord)
     {
         deleteStartOfWord();
     }
@@ -282,20 +309,38 @@ void TrainingLineCore::add(const QString& text)
     const int maxLength = m_referenceLine.length();
     const int actualLength = m_actualLine.length();
 
-    const QString newText = text.left(maxLength - actualLength);
+    QElapsedTimer timer;
+    timer.start();
+
+    // no temporary strings are created per character, m_actualLine has
+    // been reserved for the whole reference line by setReferenceLine(), and
+    // it is only copied if a reader still holds on to the last actual line
+
+    const int newLength = qMin(text.length(), maxLength - actualLength);
+    const bool recordKeystrokes = m_trainingStats && Preferences::recordKeystrokes();
     bool correct = isCorrect();
 
-    for (int i = 0; i < newText.length(); i++)
+    for (int i = 0; i < newLength; i++)
     {
-        const QString character(newText.at(i));
-        const QString referenceCharacter(m_referenceLine.at(actualLength + i));
+        const QChar character = text.at(i);
+        const QChar referenceCharacter = m_referenceLine.at(actualLength + i);
         const bool characterIsCorrect = character == referenceCharacter;
 
+        if (!characterIsCorrect && m_firstErrorPosition == -1)
+        {
+            m_firstErrorPosition = actualLength + i;
+        }
+
         if (m_trainingStats)
         {
             m_trainingStats->logCharacter(referenceCharacter, characterIsCorrect? TrainingStats::CorrectCharacter: TrainingStats::IncorrectCharacter);
         }
 
+        if (recordKeystrokes)
+        {
+            m_trainingStats->logKeystroke(referenceCharacter, character);
+        }
+
         correct = correct && (!Preferences::enforceTypingErrorCorrection() || characterIsCorrect);
 
         if (correct)
@@ -308,7 +353,10 @@ void TrainingLineCore::add(const QString& text)
         }
     }
 
-    m_actualLine += text.left(maxLength - actualLength);
+    m_actualLine.append(text.constData(), newLength);
+
+    qCDebug(trainingLineCoreTiming) << "add:" << timer.nsecsElapsed() << "ns";
+
     emit actualLineChanged();
 }
 
@@ -318,7 +366,8 @@ void TrainingLineCore::backspace()
 
     if (actualLength > 0 && Preferences::enforceTypingErrorCorrection())
     {
-        m_actualLine = m_actualLine.left(actualLength - 1);
+        logCorrection();
+        truncateActualLine(actualLength - 1);
         emit actualLineChanged();
 
         if (isCorrect())
@@ -339,17 +388,37 @@ void TrainingLineCore::deleteStartOfWord()
         finder.setPosition(actualLength);
         finder.toPreviousBoundary();
 
-        m_actualLine = m_actualLine.left(finder.position());
+        logCorrection();
+        truncateActualLine(finder.position());
         emit actualLineChanged();
     }
 }
 
+void TrainingLineCore::logCorrection()
+{
+    if (m_trainingStats && Preferences::recordKeystrokes())
+    {
+        m_trainingStats->logCorrection();
+    }
+}
+
 void TrainingLineCore::clearActualLine()
 {
-    m_actualLine = "";
+    m_actualLine.resize(0);
+    m_firstErrorPosition = -1;
     emit actualLineChanged();
 }
 
+void TrainingLineCore::truncateActualLine(int length)
+{
+    m_actualLine.truncate(length);
+
+    if (m_firstErrorPosition >= length)
+    {
+        m_firstErrorPosition = -1;
+    }
+}
+
 void TrainingLineCore::giveKeyHint(int key)
 {
     if (key == m_hintKey)
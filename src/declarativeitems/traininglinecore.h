@@ -34,6 +34,7 @@ class TrainingLineCore : public QQuickItem
     Q_PROPERTY(QString actualLine READ actualLine NOTIFY actualLineChanged)
     Q_PROPERTY(QString preeditString READ preeditString NOTIFY preeditStringChanged)
     Q_PROPERTY(bool isCorrect READ isCorrect NOTIFY actualLineChanged)
+    Q_PROPERTY(int firstErrorPosition READ firstErrorPosition NOTIFY actualLineChanged)
     Q_PROPERTY(QString nextCharacter READ nextCharacter NOTIFY actualLineChanged)
     Q_PROPERTY(int hintKey READ hintKey NOTIFY hintKeyChanged)
 public:
@@ -49,6 +50,7 @@ public:
     QString actualLine() const;
     QString preeditString() const;
     bool isCorrect() const;
+    int firstErrorPosition() const;
     QString nextCharacter() const;
     int hintKey() const;
 public slots:
@@ -70,13 +72,16 @@ private:
     void add(const QString& text);
     void backspace();
     void deleteStartOfWord();
+    void logCorrection();
     void clearActualLine();
+    void truncateActualLine(int length);
     void giveKeyHint(int key);
     void clearKeyHint();
     bool m_active;
     TrainingStats* m_trainingStats;
     QString m_referenceLine;
     QString m_actualLine;
+    int m_firstErrorPosition;
     QString m_preeditString;
     int m_hintKey;
     int m_keyHintOccurrenceCount;
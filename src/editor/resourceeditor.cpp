@@ -110,7 +110,16 @@ ResourceEditor::ResourceEditor(QWidget *parent) :
     resourceView->setModel(m_categorizedResourceModel);
     connect(resourceView->selectionModel(), SIGNAL(selectionChanged(QItemSelection,QItemSelection)), SLOT(onResourceSelected()));
 
-    selectFirstResource();
+    // the data index may still be loading when the editor is opened right
+    // at startup
+    if (m_dataIndex->isReady())
+    {
+        selectFirstResource();
+    }
+    else
+    {
+        connect(m_dataIndex, SIGNAL(isReadyChanged()), SLOT(onDataIndexReadyChanged()));
+    }
 
     connect(m_editorWidget, SIGNAL(resourceRestorationRequested()), SLOT(restoreResourceBackup()));
     connect(m_editorWidget, SIGNAL(resourceRestorationDismissed()), SLOT(clearResourceBackup()));
@@ -492,6 +501,19 @@ void ResourceEditor::selectDataResource(Resource* resource)
     }
 }
 
+void ResourceEditor::onDataIndexReadyChanged()
+{
+    if (!m_dataIndex->isReady())
+        return;
+
+    disconnect(m_dataIndex, SIGNAL(isReadyChanged()), this, SLOT(onDataIndexReadyChanged()));
+
+    if (!m_currentResource)
+    {
+        selectFirstResource();
+    }
+}
+
 void ResourceEditor::selectFirstResource()
 {
     QAbstractItemView* const resourceView = m_editorWidget->resourceView();
@@ -52,6 +52,7 @@ private slots:
     void save();
     void setUndoText(const QString& text);
     void setRedoText(const QString& text);
+    void onDataIndexReadyChanged();
 
 private:
     void prepareResourceRestore(Resource* backup);
@@ -70,10 +70,14 @@ int main(int argc, char **argv)
 
     parser.addOption({{"I", "import-path"}, i18n("Prepend the path to the list of QML import paths"), "path"});
 
+    parser.addOption(QCommandLineOption(QStringLiteral("startup-timings"), i18n("Print how long the phases of the startup take")));
+
     parser.process(app);
 
     about.processCommandLine(&parser);
 
+    app.setShowStartupTimings(parser.isSet("startup-timings"));
+
     if (parser.isSet("import-path"))
     {
         foreach (const QString& path, parser.values("import-path"))
@@ -118,12 +122,14 @@ int main(int argc, char **argv)
             ResourceEditor* resourceEditor = resourceEditorRef.data();
 
             resourceEditor->show();
+            Application::recordStartupPhase("resource editor shown");
         }
         else
         {
             MainWindow *mainWin = 0;
             mainWin = new MainWindow();
             mainWin->show();
+            Application::recordStartupPhase("main window shown");
         }
     }
 
@@ -55,6 +55,8 @@ void MainWindow::init()
     m_view->rootContext()->setContextProperty(QStringLiteral("ktouch"), m_context);
     m_view->setResizeMode(QQuickView::SizeRootObjectToView);
     m_view->setSource(QUrl("qrc:/qml/main.qml"));
+
+    Application::recordStartupPhase("QML scene loaded");
 }
 
 void MainWindow::onViewStatusChanged(QQuickView::Status status)
@@ -19,11 +19,6 @@
 
 #include "core/trainingstats.h"
 
-bool lessThan(const QPair<QString,int>& left, const QPair<QString,int>& right)
-{
-    return left.second > right.second;
-}
-
 ErrorsModel::ErrorsModel(QObject* parent) :
     QAbstractTableModel(parent),
     m_trainingStats(0)
@@ -57,6 +52,7 @@ void ErrorsModel::setTrainingStats(TrainingStats* trainingStats)
         if (m_trainingStats)
         {
             connect(m_trainingStats, SIGNAL(errorsChanged()), SLOT(buildErrorList()));
+            connect(m_trainingStats, SIGNAL(errorLogged(uint)), SLOT(logError(uint)));
         }
 
         buildErrorList();
@@ -95,10 +91,7 @@ int ErrorsModel::rowCount(const QModelIndex& parent) const
     if (parent.isValid())
         return 0;
 
-    if (!m_trainingStats)
-        return 0;
-
-    return m_trainingStats->errorMap().count();
+    return m_errors.count();
 }
 
 QVariant ErrorsModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -124,25 +117,71 @@ void ErrorsModel::buildErrorList()
 
     m_errors.clear();
 
-    if (!m_trainingStats)
+    if (m_trainingStats)
     {
-        endResetModel();
-        return;
+        // already sorted by error count
+
+        const ErrorHistogram& errorHistogram = m_trainingStats->errorHistogram();
+
+        for (int i = 0; i < errorHistogram.size(); i++)
+        {
+            m_errors.append(qMakePair(QString(QChar(errorHistogram.codepointAt(i))), errorHistogram.countAt(i)));
+        }
     }
 
-    QMapIterator<QString, int> errorIterator(m_trainingStats->errorMap());
+    endResetModel();
+
+    emit maximumErrorCountChanged();
+}
+
+void ErrorsModel::logError(uint codepoint)
+{
+    const QString character = QString(QChar(codepoint));
+    int row = 0;
+
+    while (row < m_errors.count() && m_errors.at(row).first != character)
+    {
+        row++;
+    }
 
-    while(errorIterator.hasNext())
+    if (row == m_errors.count())
     {
-        errorIterator.next();
-        m_errors.append(QPair<QString,int>(errorIterator.key(), errorIterator.value()));
+        beginInsertRows(QModelIndex(), row, row);
+        m_errors.append(qMakePair(character, 1));
+        endInsertRows();
     }
+    else
+    {
+        // bubble the entry up to keep the rows sorted by error count
 
-    qSort(m_errors.begin(), m_errors.end(), lessThan);
+        const int count = m_errors.at(row).second + 1;
+        int newRow = row;
 
-    emit maximumErrorCountChanged();
+        while (newRow > 0 && m_errors.at(newRow - 1).second < count)
+        {
+            newRow--;
+        }
 
-    endResetModel();
+        if (newRow != row)
+        {
+            beginMoveRows(QModelIndex(), row, row, QModelIndex(), newRow);
+            m_errors.move(row, newRow);
+            m_errors[newRow].second = count;
+            endMoveRows();
+        }
+        else
+        {
+            m_errors[row].second = count;
+        }
+
+        row = newRow;
+        emit dataChanged(index(row, 0), index(row, 0));
+    }
+
+    if (row == 0)
+    {
+        emit maximumErrorCountChanged();
+    }
 }
 
 QString ErrorsModel::character(int row) const
@@ -20,6 +20,8 @@
 
 #include <QAbstractTableModel>
 
+#include <QPair>
+
 class TrainingStats;
 
 class ErrorsModel : public QAbstractTableModel
@@ -43,6 +45,7 @@ signals:
     void maximumErrorCountChanged();
 private slots:
     void buildErrorList();
+    void logError(uint codepoint);
 private:
     TrainingStats* m_trainingStats;
     QList<QPair<QString, int> > m_errors;
@@ -19,6 +19,7 @@
 
 #include <QSqlRecord>
 
+#include "application.h"
 #include "core/profile.h"
 #include "core/course.h"
 #include "core/lesson.h"
@@ -30,6 +31,11 @@ LearningProgressModel::LearningProgressModel(QObject* parent) :
     m_courseFilter(0),
     m_lessonFilter(0)
 {
+    // training stats are saved asynchronously, the new session may arrive
+    // after the model has been populated, or fail to be saved and be retried
+    connect(Application::trainingStatsWriter(), SIGNAL(recordsSaved()), SLOT(update()));
+    connect(Application::trainingStatsWriter(), SIGNAL(recordsSaved()), SLOT(onRecordsSaved()));
+    connect(Application::trainingStatsWriter(), SIGNAL(recordsNotSaved(QString)), SLOT(onRecordsNotSaved(QString)));
 }
 
 Profile* LearningProgressModel::profile() const
@@ -135,6 +141,11 @@ qreal LearningProgressModel::minAccuracy() const
     return min;
 }
 
+QString LearningProgressModel::saveErrorMessage() const
+{
+    return m_saveErrorMessage;
+}
+
 int LearningProgressModel::columnCount(const QModelIndex& parent) const
 {
     Q_UNUSED(parent)
@@ -279,3 +290,21 @@ void LearningProgressModel::profileDestroyed()
 {
     setProfile(0);
 }
+
+void LearningProgressModel::onRecordsSaved()
+{
+    if (!m_saveErrorMessage.isEmpty())
+    {
+        m_saveErrorMessage.clear();
+        emit saveErrorMessageChanged();
+    }
+}
+
+void LearningProgressModel::onRecordsNotSaved(const QString& errorMessage)
+{
+    if (errorMessage != m_saveErrorMessage)
+    {
+        m_saveErrorMessage = errorMessage;
+        emit saveErrorMessageChanged();
+    }
+}
@@ -33,6 +33,7 @@ class LearningProgressModel : public QSqlQueryModel
     Q_PROPERTY(Lesson* lessonFilter READ lessonFilter WRITE setLessonFilter NOTIFY lessonFilterChanged)
     Q_PROPERTY(int maxCharactersTypedPerMinute READ maxCharactersTypedPerMinute NOTIFY maxCharactersTypedPerMinuteChanged)
     Q_PROPERTY(qreal minAccuracy READ minAccuracy NOTIFY minAccuracyChanged)
+    Q_PROPERTY(QString saveErrorMessage READ saveErrorMessage NOTIFY saveErrorMessageChanged)
 public:
     explicit LearningProgressModel(QObject* parent = 0);
     Profile* profile() const;
@@ -43,6 +44,7 @@ public:
     void setLessonFilter(Lesson* lessonFilter);
     int maxCharactersTypedPerMinute() const;
     qreal minAccuracy() const;
+    QString saveErrorMessage() const;
     int columnCount(const QModelIndex& parent = QModelIndex()) const;
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
     Q_INVOKABLE int charactersPerMinute(int row) const;
@@ -59,8 +61,11 @@ signals:
     void lessonFilterChanged();
     void maxCharactersTypedPerMinuteChanged();
     void minAccuracyChanged();
+    void saveErrorMessageChanged();
 private slots:
     void profileDestroyed();
+    void onRecordsSaved();
+    void onRecordsNotSaved(const QString& errorMessage);
 private:
     QVariant data(const QModelIndex& item, int role = Qt::DisplayRole) const;
     QVariant accuracyData(int row, int role = Qt::DisplayRole) const;
@@ -69,6 +74,7 @@ private:
     Profile* m_profile;
     Course* m_courseFilter;
     Lesson* m_lessonFilter;
+    QString m_saveErrorMessage;
 };
 
 #endif // LEARNINGPROGRESSMODEL_H
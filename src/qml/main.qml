@@ -49,9 +49,14 @@ Rectangle {
         property string name: ktouch.keyboardLayoutName
         property int keyboardLayoutCount: ktouch.globalDataIndex.keyboardLayoutCount
         property int courseCount: ktouch.globalDataIndex.courseCount
+        property bool dataIndexReady: ktouch.globalDataIndex.isReady
         onNameChanged: {
             keyboardLayout.update()
         }
+        onDataIndexReadyChanged: {
+            if (dataIndexReady && ktouch.globalDataIndex.isValid)
+                keyboardLayout.update()
+        }
         onKeyboardLayoutCountChanged: {
             if (ktouch.globalDataIndex.isValid)
                 keyboardLayout.update()
@@ -145,6 +150,10 @@ Rectangle {
             }
             selectedCourse.copyFrom(course)
 
+            // the training works on the copy, the lesson selector doesn't
+            // need the texts it has just fetched anymore
+            course.evictLessonTexts()
+
             if (lessonIndex !== -1) {
                 selectedCourse.selectedLesson = selectedCourse.lesson(lessonIndex)
             }
@@ -182,6 +191,11 @@ Rectangle {
         stats: trainingScreen.stats
         profile: trainingScreen.profile
         referenceStats: trainingScreen.referenceStats
+        onNextLessonChanged: {
+            if (nextLesson) {
+                trainingScreen.prefetchLesson(nextLesson)
+            }
+        }
         onHomeScreenRequested: main.switchScreen(scoreScreen, homeScreen)
         onLessonRepetionRequested: main.switchScreen(scoreScreen, trainingScreen)
         onNextLessonRequested: {
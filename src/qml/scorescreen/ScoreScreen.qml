@@ -91,6 +91,7 @@ FocusScope {
     property Course course
     property TrainingStats stats
     property TrainingStats referenceStats
+    property alias nextLesson: internal.nextLesson
 
     signal homeScreenRequested
     signal nextLessonRequested(variant lesson)
@@ -115,6 +116,14 @@ FocusScope {
         profile: screen.visible? screen.profile: null
         courseFilter: screen.visible? screen.course: null
         lessonFilter: screen.visible && filterByLesson? screen.lesson: null
+        onSaveErrorMessageChanged: {
+            if (saveErrorMessage !== "") {
+                saveErrorMessageBox.showMessage(i18n("Your results could not be saved yet, KTouch keeps trying."), "dialog-warning")
+            }
+            else {
+                saveErrorMessageBox.clearMessage()
+            }
+        }
     }
 
     ErrorsModel {
@@ -262,6 +271,10 @@ FocusScope {
                     onClicked: screen.homeScreenRequested()
                 }
 
+                MessageBox {
+                    id: saveErrorMessageBox
+                }
+
                 Item {
                     Layout.fillHeight: true
                     Layout.fillWidth: true
@@ -104,6 +104,10 @@ FocusScope {
         trainingWidget.forceActiveFocus()
     }
 
+    function prefetchLesson(lesson) {
+        trainingWidget.prefetchLesson(lesson)
+    }
+
     onLessonChanged: setLessonKeys()
 
     onIsActiveChanged: {
@@ -31,6 +31,7 @@ FocusScope {
 
     property alias nextChar: trainingLine.nextCharacter
     property alias isCorrect: trainingLine.isCorrect
+    property alias firstErrorPosition: trainingLine.firstErrorPosition
     property int position: -1
     signal finished
     signal keyPressed(variant event)
@@ -47,6 +48,10 @@ FocusScope {
         trainingLine.forceActiveFocus()
     }
 
+    function prefetchLesson(lesson) {
+        lessonPainter.prefetchLesson(lesson)
+    }
+
     Timer {
         id: stopTimer
         interval: 5000